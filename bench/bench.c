@@ -0,0 +1,348 @@
+/*
+ * mengine-bench
+ * Headless ray casting benchmark. Replays camera paths over a set of maps with every traversal
+ * variant at every RenderQuality level and reports rays/sec, DDA steps per ray and the
+ * p50/p95/p99 frame cast time as JSON. Steps are counted by the traversals themselves, a block
+ * crossed whole by the pyramid or sphere modes is one step and interpolated or cached rays take
+ * none. No window or GL context is created.
+ *
+ * Usage: mengine-bench [--out results.json] [--path recorded.txt]... [--threads n] [--repeat n]
+ *
+ * --threads counts the main thread, 0 (default) uses every core. Recorded paths are plain text,
+ * the first line is "map <name>" naming one of the maps below, every following line is one
+ * frame "x y rotation", e.g. player.position and player.rotation logged once per frame.
+ */
+
+#include "renderer.h"
+#include "helpful_math.h"
+#include "job_system.h"
+#include "ray_packet.h"
+#include "bench_timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MAP_LENGTH 10
+#define MAX_WAYPOINTS 10
+#define MAX_PATH_FRAMES 4096
+#define MAX_PATHS 16
+#define PATROL_STEP 0.05f
+
+typedef struct CameraSample {
+	Vector2 position;
+	float rotation;
+} CameraSample;
+
+typedef struct CameraPath {
+	char name[64];
+	char mapName[64];
+	int frameCount;
+	CameraSample frames[MAX_PATH_FRAMES];
+} CameraPath;
+
+typedef struct BenchMap {
+	const char *name;
+	unsigned int cells[MAP_LENGTH][MAP_LENGTH];
+	Vector2 waypoints[MAX_WAYPOINTS];	// Closed loop through open cells, the first one is also the spin point
+	int waypointCount;
+	Map map;	// Loaded from cells on startup
+} BenchMap;
+
+typedef struct BenchVariant {
+	const char *name;
+	bool linear;	// DDA() instead of DDANonLinear()
+	TraversalMode mode;
+	bool coherent;	// Interpolate columns that hit the same wall face, see UpdateCoherentRays()
+	bool rotationCache;	// Reuse hits while the camera only turns, see UpdateRotationCache()
+} BenchVariant;
+
+static BenchMap maps[] = {
+	{
+		"rooms",
+		{
+			{ 1,1,1,1,1,1,1,1,1,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,0,0,1,0,0,1,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,1,1,0,0,0,0,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,1,0,0,1,1,1,0,1 },
+			{ 1,0,1,0,0,1,1,1,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,1,1,1,1,1,1,1,1,1 },
+		},
+		{ { 1.5f, 1.5f }, { 7.5f, 1.5f }, { 7.5f, 5.5f }, { 3.5f, 5.5f }, { 3.5f, 8.5f }, { 8.5f, 8.5f }, { 8.5f, 3.5f }, { 3.5f, 3.5f }, { 3.5f, 1.5f } },
+		9
+	},
+	{
+		"open",
+		{
+			{ 1,1,1,1,1,1,1,1,1,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,1,1,1,1,1,1,1,1,1 },
+		},
+		{ { 1.5f, 1.5f }, { 8.5f, 1.5f }, { 8.5f, 8.5f }, { 1.5f, 8.5f } },
+		4
+	},
+	{
+		"pillars",
+		{
+			{ 1,1,1,1,1,1,1,1,1,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,1,0,0,1,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,1,0,0,1,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,0,0,0,0,0,0,0,0,1 },
+			{ 1,1,1,1,1,1,1,1,1,1 },
+		},
+		{ { 1.5f, 1.5f }, { 8.5f, 1.5f }, { 8.5f, 8.5f }, { 1.5f, 8.5f } },
+		4
+	},
+};
+
+static const BenchVariant variants[] = {
+	{ "DDA", true, DDA_SCALAR },
+	{ "DDANonLinear/scalar", false, DDA_SCALAR },
+	{ "DDANonLinear/packet", false, DDA_PACKET },
+	{ "DDANonLinear/fixed", false, DDA_FIXED },
+	{ "DDANonLinear/pyramid", false, DDA_PYRAMID },
+	{ "DDANonLinear/sphere", false, DDA_SPHERE },
+	{ "DDANonLinear/scalar+coherent", false, DDA_SCALAR, true },
+	{ "DDANonLinear/packet+coherent", false, DDA_PACKET, true },
+	{ "DDANonLinear/scalar+rotationcache", false, DDA_SCALAR, false, true },
+	{ "DDANonLinear/packet+rotationcache", false, DDA_PACKET, false, true },
+};
+
+static const char *qualityNames[] = { "VERY_LOW", "LOW", "MEDIUM", "HIGH", "ULTRA" };
+
+static CameraPath paths[MAX_PATHS];
+static int pathCount = 0;
+static struct RayData rays[VIEWPORT_WIDTH + 1];
+
+static int FindMap(const char *name)
+{
+	for (int i = 0; i < sizeof(maps) / sizeof(maps[0]); i++)
+	{
+		if (strcmp(maps[i].name, name) == 0) { return i; }
+	}
+	return -1;
+}
+
+/*
+ * Turns on the spot at the map's first waypoint, half a degree per frame.
+ */
+static void AddSpinPath(const BenchMap *map)
+{
+	CameraPath *path = &paths[pathCount++];
+	snprintf(path->name, sizeof(path->name), "spin");
+	snprintf(path->mapName, sizeof(path->mapName), "%s", map->name);
+	path->frameCount = 720;
+	for (int i = 0; i < path->frameCount; i++)
+	{
+		path->frames[i].position = map->waypoints[0];
+		path->frames[i].rotation = i * 0.5f;
+	}
+}
+
+/*
+ * Walks the waypoint loop at a fixed speed, looking along the direction of travel while sweeping
+ * 30 degrees either side the way a player looks around.
+ */
+static void AddPatrolPath(const BenchMap *map)
+{
+	CameraPath *path = &paths[pathCount++];
+	snprintf(path->name, sizeof(path->name), "patrol");
+	snprintf(path->mapName, sizeof(path->mapName), "%s", map->name);
+	path->frameCount = 0;
+	for (int w = 0; w < map->waypointCount; w++)
+	{
+		Vector2 from = map->waypoints[w];
+		Vector2 to = map->waypoints[(w + 1) % map->waypointCount];
+		float length = Vector2Distance(from, to);
+		float heading = atan2f(to.y - from.y, to.x - from.x) * RAD2DEG;
+		for (float travelled = 0.0f; travelled < length && path->frameCount < MAX_PATH_FRAMES; travelled += PATROL_STEP)
+		{
+			CameraSample *sample = &path->frames[path->frameCount];
+			sample->position = Vector2Lerp(from, to, travelled / length);
+			sample->rotation = heading + (30.0f * sinf(path->frameCount * 0.05f));
+			path->frameCount++;
+		}
+	}
+}
+
+static bool LoadRecordedPath(const char *fileName)
+{
+	FILE *file = fopen(fileName, "r");
+	if (file == NULL || pathCount >= MAX_PATHS) { return false; }
+
+	CameraPath *path = &paths[pathCount];
+	char line[256];
+	bool valid = fgets(line, sizeof(line), file) != NULL && sscanf(line, "map %63s", path->mapName) == 1 && FindMap(path->mapName) >= 0;
+	snprintf(path->name, sizeof(path->name), "%s", fileName);
+	path->frameCount = 0;
+	while (valid && path->frameCount < MAX_PATH_FRAMES && fgets(line, sizeof(line), file) != NULL)
+	{
+		CameraSample *sample = &path->frames[path->frameCount];
+		if (sscanf(line, "%f %f %f", &sample->position.x, &sample->position.y, &sample->rotation) == 3)
+		{
+			path->frameCount++;
+		}
+	}
+	fclose(file);
+
+	if (!valid || path->frameCount == 0) { return false; }
+	pathCount++;
+	return true;
+}
+
+static int CompareDoubles(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+// Nearest rank percentile of an already sorted array
+static double Percentile(const double sorted[], int count, double percent)
+{
+	int rank = (int)ceil((percent / 100.0) * count) - 1;
+	return sorted[rank < 0 ? 0 : rank];
+}
+
+static void RunBenchmark(FILE *out, const CameraPath *path, const BenchVariant *variant, RenderQuality quality, int repeat, bool first)
+{
+	UpdateRenderQuality(quality);
+	UpdateTraversalMode(variant->mode);
+	UpdateCoherentRays(variant->coherent);
+	UpdateRotationCache(variant->rotationCache);
+
+	const int frameCount = path->frameCount * repeat;
+	double *frameTimes = malloc(frameCount * sizeof(double));
+	double totalTime = 0.0;
+	long long totalRays = 0;
+	long long totalSteps = 0;
+
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		const CameraSample *sample = &path->frames[frame % path->frameCount];
+		UpdateRenderCamera(sample->position, sample->rotation);
+
+		double start = GetBenchTime();
+		if (variant->linear)
+		{
+			DDA(rays, sample->position, sample->rotation);
+		}
+		else
+		{
+			DDANonLinear(rays, sample->position, sample->rotation);
+		}
+		frameTimes[frame] = GetBenchTime() - start;
+		totalTime += frameTimes[frame];
+
+		const unsigned int rayCount = GetRayCount() + 1;
+		totalRays += rayCount;
+		for (unsigned int i = 0; i < rayCount; i++)
+		{
+			totalSteps += rays[i].steps;
+		}
+	}
+
+	qsort(frameTimes, frameCount, sizeof(double), CompareDoubles);
+	fprintf(out, "%s\n    {\"map\": \"%s\", \"path\": \"%s\", \"variant\": \"%s\", \"quality\": \"%s\", ", first ? "" : ",", path->mapName, path->name, variant->name, qualityNames[quality]);
+	fprintf(out, "\"frames\": %d, \"rays\": %lld, \"rays_per_sec\": %.0f, \"steps_per_ray\": %.3f, ", frameCount, totalRays, totalTime > 0.0 ? totalRays / totalTime : 0.0, (double)totalSteps / (double)totalRays);
+	fprintf(out, "\"frame_ms\": {\"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f}}",
+		Percentile(frameTimes, frameCount, 50.0) * 1000.0,
+		Percentile(frameTimes, frameCount, 95.0) * 1000.0,
+		Percentile(frameTimes, frameCount, 99.0) * 1000.0);
+	free(frameTimes);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *outName = NULL;
+	int threads = 0;
+	int repeat = 1;
+
+	SetTraceLogLevel(LOG_WARNING);
+
+	for (int m = 0; m < sizeof(maps) / sizeof(maps[0]); m++)
+	{
+		AddSpinPath(&maps[m]);
+		AddPatrolPath(&maps[m]);
+	}
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) { outName = argv[++i]; }
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) { threads = atoi(argv[++i]); }
+		else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) { repeat = atoi(argv[++i]); }
+		else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc)
+		{
+			const char *fileName = argv[++i];
+			if (!LoadRecordedPath(fileName))
+			{
+				fprintf(stderr, "Could not load camera path %s\n", fileName);
+				return 1;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--out results.json] [--path recorded.txt]... [--threads n] [--repeat n]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	repeat = MAX(repeat, 1);
+
+	FILE *out = outName != NULL ? fopen(outName, "w") : stdout;
+	if (out == NULL)
+	{
+		fprintf(stderr, "Could not open %s\n", outName);
+		return 1;
+	}
+
+	// --threads 1 means just the main thread, anything else is the total thread count
+	if (threads != 1) { CreateJobSystem(threads > 1 ? threads - 1 : 0); }
+	for (int m = 0; m < sizeof(maps) / sizeof(maps[0]); m++)
+	{
+		maps[m].map = LoadMapFromArray(&maps[m].cells[0][0], MAP_LENGTH, MAP_LENGTH);
+	}
+	CreateHeadlessRenderer(90, &maps[0].map);
+
+	fprintf(out, "{\n  \"threads\": %u,\n  \"packet_width\": %d,\n  \"benchmarks\": [", GetJobWorkerCount() + 1, GetRayPacketWidth());
+	bool first = true;
+	for (int p = 0; p < pathCount; p++)
+	{
+		UpdateRendererMapData(&maps[FindMap(paths[p].mapName)].map);
+		for (int v = 0; v < sizeof(variants) / sizeof(variants[0]); v++)
+		{
+			for (int q = VERY_LOW; q <= ULTRA; q++)
+			{
+				RunBenchmark(out, &paths[p], &variants[v], q, repeat, first);
+				first = false;
+			}
+		}
+	}
+	fprintf(out, "\n  ]\n}\n");
+
+	if (out != stdout) { fclose(out); }
+	UnloadTextures();
+	DestroyJobSystem();
+	for (int m = 0; m < sizeof(maps) / sizeof(maps[0]); m++)
+	{
+		UnloadMap(maps[m].map);
+	}
+	return 0;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Monotonic wall clock in seconds, kept apart from raylib since GetTime() needs a window
+double GetBenchTime();
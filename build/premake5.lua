@@ -177,6 +177,108 @@ workspace (workspaceName)
             links {"OpenGL.framework", "Cocoa.framework", "IOKit.framework", "CoreFoundation.framework", "CoreAudio.framework", "CoreVideo.framework", "AudioToolbox.framework"}
 
         filter{}
+
+    project "mengine-bench"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
+
+        filter "action:vs*"
+            debugdir "$(SolutionDir)"
+
+        filter{}
+
+        vpaths 
+        {
+            ["Header Files/*"] = { "../include/**.h", "../bench/**.h"},
+            ["Source Files/*"] = { "../src/**.c", "../bench/**.c"},
+        }
+        -- Same engine sources as the game minus its main(), nothing here opens a window
+        files {"../src/**.c", "../include/**.h", "../bench/**.c", "../bench/**.h"}
+        removefiles {"../src/main.c"}
+
+        includedirs { "../src" }
+        includedirs { "../include" }
+        includedirs { "../bench" }
+
+        links {"raylib"}
+
+        includedirs {raylib_dir .. "/src" }
+        includedirs {raylib_dir .."/src/external" }
+        includedirs { raylib_dir .."/src/external/glfw/include" }
+        flags { "ShadowedVariables"}
+        platform_defines()
+
+        filter "action:vs*"
+            defines{"_WINSOCK_DEPRECATED_NO_WARNINGS", "_CRT_SECURE_NO_WARNINGS"}
+            dependson {"raylib"}
+            links {"raylib.lib"}
+            characterset ("Unicode")
+            buildoptions { "/Zc:__cplusplus" }
+
+        filter "system:windows"
+            defines{"_WIN32"}
+            links {"winmm", "gdi32"}
+            libdirs {"../bin/%{cfg.buildcfg}"}
+
+        filter "system:linux"
+            links {"pthread", "m", "dl", "rt", "X11"}
+
+        filter "system:macosx"
+            links {"OpenGL.framework", "Cocoa.framework", "IOKit.framework", "CoreFoundation.framework", "CoreAudio.framework", "CoreVideo.framework", "AudioToolbox.framework"}
+
+        filter{}
+		
+
+    project "mengine-level"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
+
+        filter "action:vs*"
+            debugdir "$(SolutionDir)"
+
+        filter{}
+
+        vpaths 
+        {
+            ["Header Files/*"] = { "../include/**.h"},
+            ["Source Files/*"] = { "../src/**.c", "../tools/**.c"},
+        }
+        -- Level converter, same engine sources as the game minus its main()
+        files {"../src/**.c", "../include/**.h", "../tools/**.c"}
+        removefiles {"../src/main.c"}
+
+        includedirs { "../src" }
+        includedirs { "../include" }
+
+        links {"raylib"}
+
+        includedirs {raylib_dir .. "/src" }
+        includedirs {raylib_dir .."/src/external" }
+        includedirs { raylib_dir .."/src/external/glfw/include" }
+        flags { "ShadowedVariables"}
+        platform_defines()
+
+        filter "action:vs*"
+            defines{"_WINSOCK_DEPRECATED_NO_WARNINGS", "_CRT_SECURE_NO_WARNINGS"}
+            dependson {"raylib"}
+            links {"raylib.lib"}
+            characterset ("Unicode")
+            buildoptions { "/Zc:__cplusplus" }
+
+        filter "system:windows"
+            defines{"_WIN32"}
+            links {"winmm", "gdi32"}
+            libdirs {"../bin/%{cfg.buildcfg}"}
+
+        filter "system:linux"
+            links {"pthread", "m", "dl", "rt", "X11"}
+
+        filter "system:macosx"
+            links {"OpenGL.framework", "Cocoa.framework", "IOKit.framework", "CoreFoundation.framework", "CoreAudio.framework", "CoreVideo.framework", "AudioToolbox.framework"}
+
+        filter{}
 		
 
     project "raylib"
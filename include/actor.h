@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "raylib.h"
+#include "map.h"
+#include "distance_field.h"
+
+// Handles are an index into the store's handle table plus the generation of that entry, so a
+// handle to a despawned actor stays invalid even after its entry is reused.
+typedef uint32_t ActorHandle;
+
+#define ACTOR_HANDLE_NONE 0
+#define ACTOR_INDEX_BITS 20
+#define ACTOR_MAX_CAPACITY (1 << ACTOR_INDEX_BITS)
+
+typedef enum ActorKind {
+	ACTOR_NPC,
+	ACTOR_PROJECTILE
+} ActorKind;
+
+// Set in ActorStore.flags
+#define ACTOR_BLOCKED 1		// A wall stopped some of the actor's last move, it slid along it
+
+// Every actor that isn't the player. Each property is its own array and live actors are packed
+// into slots [0, count), so UpdateActors() runs straight down the arrays one property at a time.
+// Slots move when actors despawn, look them up through the handle with GetActorSlot().
+typedef struct ActorStore {
+	int capacity;
+	int count;
+	// Per slot
+	float *positionX;
+	float *positionY;
+	float *rotation;		// Degrees, like Player.rotation
+	float *forwardX;		// Kept in step with rotation by SetActorRotation()
+	float *forwardY;
+	float *speed;			// Cells per second along forward
+	float *radius;			// Collider
+	uint8_t *kind;
+	uint8_t *flags;
+	ActorHandle *handles;	// Handle of the actor in each slot
+	// Per handle index
+	int *slots;				// -1 while the index is free
+	uint16_t *generations;
+	int *nextFree;
+	int freeHead;
+	// Scratch for UpdateActors()
+	float *targetX;
+	float *targetY;
+	float *clearance;
+	int *nearWall;			// Slots that need a swept move
+	uint8_t *hits;			// COLLISION_HIT_* of those moves
+} ActorStore;
+
+ActorStore LoadActorStore(int capacity);
+void UnloadActorStore(ActorStore store);
+ActorHandle SpawnActor(ActorStore *store, ActorKind kind, Vector2 position, float rotation, float speed, float radius);
+void DespawnActor(ActorStore *store, ActorHandle handle);
+bool IsActorAlive(const ActorStore *store, ActorHandle handle);
+int GetActorSlot(const ActorStore *store, ActorHandle handle);
+void SetActorRotation(ActorStore *store, int slot, float rotation);
+void UpdateActors(ActorStore *store, const Map *map, const DistanceField *field, float deltaTime);
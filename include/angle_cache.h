@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+#include "raylib.h"
+#include "occupancy.h"
+
+// Directions sampled around the full circle, about 0.18 degrees apart. Must be a power of 2.
+#define ANGLE_CACHE_SIZE 2048
+
+typedef enum CameraMotion {
+	CAMERA_STILL,
+	CAMERA_ROTATING,
+	CAMERA_MOVING
+} CameraMotion;
+
+// Wall cell and face hit by the ray cast in one sampled direction
+typedef struct AngleCacheHit {
+	int col;
+	int row;
+	bool hitX;
+	bool hit;	// False if the ray ran out of draw distance
+} AngleCacheHit;
+
+// Hits of rays cast from one position in every sampled direction, filled in as the camera turns.
+// Sample i points at i * 2PI / ANGLE_CACHE_SIZE radians.
+typedef struct AngleCache {
+	Vector2 position;	// Every cached hit was cast from here
+	Vector2 *directions;
+	AngleCacheHit *hits;
+	bool *cast;			// cast[i] is set once hits[i] is filled in
+} AngleCache;
+
+AngleCache LoadAngleCache();
+void UnloadAngleCache(AngleCache cache);
+void ResetAngleCache(AngleCache *cache, Vector2 position);
+void FillAngleCache(AngleCache *cache, int first, int count, const OccupancyGrid *grid, float maxDistance);
+int GetAngleCacheIndex(float angleRadians);
+CameraMotion ClassifyCameraMotion(Vector2 lastPosition, float lastRotation, Vector2 position, float rotation);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "raylib.h"
+#include "map.h"
+
+// Which cell values a circle can move through, indexed by MapCell. Everything else blocks, which
+// includes the CELL_WALL read outside the map unless a filter opens it.
+typedef struct CollisionFilter {
+	bool open[1 << (8 * sizeof(MapCell))];
+} CollisionFilter;
+
+// Set in the hits of ResolveCircleMoves()
+#define COLLISION_HIT_X 1	// A cell stopped the move along x
+#define COLLISION_HIT_Y 2
+
+// A batch of circles to move, entry i of every array belongs to circle i
+typedef struct CircleMoves {
+	float *positionX;		// Start of each move, overwritten with where the circle stopped
+	float *positionY;
+	const float *targetX;	// Where each circle tries to get to
+	const float *targetY;
+	const float *radius;
+	uint8_t *hits;			// Optional, COLLISION_HIT_* of each circle
+} CircleMoves;
+
+void ResolveCircleMoves(const Map *map, const CollisionFilter *filter, CircleMoves moves, const int *indices, int count);
+Vector2 MoveCircle(const Map *map, const CollisionFilter *filter, Vector2 position, Vector2 target, float radius, uint8_t *hits);
+bool IsCircleClear(const Map *map, const CollisionFilter *filter, Vector2 position, float radius);
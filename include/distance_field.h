@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include "raylib.h"
+#include "map.h"
+
+// Distances are capped at this many cells, anything further from a wall reads the same
+#define DISTANCE_FIELD_MAX 255
+
+// Chebyshev distance in cells from every cell of a window of the map to the nearest wall, 0 for
+// walls themselves. A cell with distance d has every cell in the (2d - 1) x (2d - 1) square centred
+// on it open. Outside the window counts as wall, so distances near its edges are only lower bounds.
+typedef struct DistanceField {
+	int col;
+	int row;
+	int width;
+	int height;
+	uint8_t *distances;	// distances[y * width + x] for x, y counted from col, row
+} DistanceField;
+
+DistanceField LoadDistanceField(const Map *map, MapRegion window);
+void UnloadDistanceField(DistanceField field);
+void UpdateDistanceField(DistanceField *field, const Map *map, int col, int row, int width, int height);
+float GetDistanceFieldClearance(const DistanceField *field, Vector2 position);
+
+// col and row are map cells
+static inline int GetDistanceFieldValue(const DistanceField *field, int col, int row)
+{
+	col -= field->col;
+	row -= field->row;
+	if (col < 0 || row < 0 || col >= field->width || row >= field->height) { return 0; }
+	return field->distances[(long)row * field->width + col];
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include "renderer.h"
+#include "occupancy.h"
+
+// 16.16 fixed point
+typedef int32_t Fixed;
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+
+// Binary angle measurement, a full turn is ANGLE_COUNT so wrapping is a single mask
+typedef int32_t BinaryAngle;
+#define ANGLE_BITS 13
+#define ANGLE_COUNT (1 << ANGLE_BITS)
+#define ANGLE_MASK (ANGLE_COUNT - 1)
+#define ANGLE_QUARTER (ANGLE_COUNT / 4)
+
+void InitFixedTables();
+Fixed FloatToFixed(float value);
+float FixedToFloat(Fixed value);
+Fixed FixedMul(Fixed a, Fixed b);
+BinaryAngle DegreesToBinaryAngle(float degrees);
+Fixed FixedSin(BinaryAngle angle);
+Fixed FixedCos(BinaryAngle angle);
+Fixed FixedTan(BinaryAngle angle);
+
+void BuildFixedColumnAngles(BinaryAngle columnAngles[], unsigned int rayCount, unsigned int fov, unsigned int viewportWidth);
+void CastRaysFixed(struct RayData rays[], const BinaryAngle columnAngles[], int first, int count, Vector2 position, float angleDegrees, const OccupancyGrid *grid, unsigned int drawDistance);
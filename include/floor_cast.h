@@ -0,0 +1,52 @@
+#pragma once
+
+#include "raylib.h"
+#include "map.h"
+#include "software_renderer.h"
+#include "texture_atlas.h"
+
+// Where a floor or ceiling texture is in the atlas, in whole texels. Four ints with nothing between
+// them, the AVX2 casting gathers the fields straight out of a SurfaceTextures array.
+typedef struct SurfaceTexture {
+	int x;
+	int y;
+	int width;
+	int height;
+} SurfaceTexture;
+
+// Texture of every floor and ceiling value, [SURFACE_DEFAULT] holds the renderer's default
+typedef struct SurfaceTextures {
+	SurfaceTexture floors[256];
+	SurfaceTexture ceilings[256];
+} SurfaceTextures;
+
+// Bytes allocated past the last cell of a SurfaceGrid, the AVX2 casting gathers a 32 bit word per cell
+#define SURFACE_GRID_PADDING 3
+
+// Dense copy of the floor and ceiling values of a window of a map, so casting reads two flat arrays
+// instead of going through the map's pages. Cells outside the window read as SURFACE_DEFAULT.
+typedef struct SurfaceGrid {
+	int col;
+	int row;
+	int width;
+	int height;
+	MapCell *floors;		// floors[y * width + x] for x, y counted from col, row
+	MapCell *ceilings;		// Same layout as floors
+} SurfaceGrid;
+
+// Camera the floor and ceiling are cast for. A floor point distance d in front of the camera that
+// shows up in block b of a row is at position + d * (rayStart + b * rayStep).
+typedef struct FloorView {
+	Vector2 position;
+	Vector2 rayStart;		// Direction through the first block, scaled to 1 along the view
+	Vector2 rayStep;		// Change of the direction from one block to the next
+	float rowScale;			// Distance of the floor one row below the horizon, halves every row
+	float lightRange;		// Surfaces closer than this are lit fully, further ones fade out
+	int blockWidth;			// Pixels that share one texel across a row, the column width
+} FloorView;
+
+SurfaceGrid LoadSurfaceGrid(const Map *map, MapRegion window);
+void UnloadSurfaceGrid(SurfaceGrid grid);
+void UpdateSurfaceGrid(SurfaceGrid *grid, const Map *map, int col, int row, int width, int height);
+void BuildSurfaceTextures(SurfaceTextures *surfaces, const TextureAtlas *atlas, int textureCount, int defaultFloor, int defaultCeiling);
+void CastFloorRows(SoftwareFramebuffer *target, const FloorView *view, const SurfaceGrid *grid, const SurfaceTextures *surfaces, const SoftwareTexture *atlas, int first, int count);
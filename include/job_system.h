@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Work function for RunParallelFor(), handles items [first, first + count)
+typedef void (*JobFunction)(void *data, int first, int count);
+
+void CreateJobSystem(unsigned int workerCount);
+void DestroyJobSystem();
+unsigned int GetJobWorkerCount();
+
+// Counts background jobs down to 0 as they finish
+typedef struct JobCounter {
+	volatile long pending;
+} JobCounter;
+
+void RunParallelFor(JobFunction function, void *data, int itemCount, int chunkSize);
+void RunBackgroundJob(JobFunction function, void *data, int first, int count, JobCounter *counter);
+bool IsJobCounterDone(JobCounter *counter);
+void WaitJobCounter(JobCounter *counter);
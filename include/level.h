@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "map.h"
+
+// On disk level format, all fields little endian whichever host wrote it. Only little endian hosts
+// can open level files, the index is read in place from the mapped file:
+//   LevelFileHeader
+//   LevelChunkInfo index[chunkCols * chunkRows], row by row
+//   chunk cells, each chunk LEVEL_CHUNK_SIZE^2 MapCells row by row, starting on a page boundary
+// Chunks are fixed size, edge chunks are padded with walls. Chunks where every cell is the same
+// store no cells at all, only the fill value in their index entry.
+#define LEVEL_FILE_MAGIC "MLVL"
+#define LEVEL_FILE_VERSION 1
+#define LEVEL_CHUNK_SIZE 64		// 64 x 64 one byte cells, one 4096 byte page per chunk
+#define LEVEL_CHUNK_ALIGN 4096
+
+typedef struct LevelFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t width;			// In cells
+	uint32_t height;
+	uint32_t chunkSize;
+	uint32_t chunkCols;
+	uint32_t chunkRows;
+	uint32_t indexOffset;	// Byte offset of the chunk index
+} LevelFileHeader;
+
+typedef struct LevelChunkInfo {
+	uint64_t offset;		// Byte offset of the chunk's cells, 0 if every cell is fill
+	uint32_t wallCount;		// Non empty cells inside the map, padding not counted
+	MapCell fill;
+	uint8_t reserved[3];
+} LevelChunkInfo;
+
+// A level file mapped read only into memory. Opening only reads the header and index, the chunk
+// cells are paged in by the OS the first time they are read.
+typedef struct LevelFile {
+	int width;
+	int height;
+	int chunkSize;
+	int chunkCols;
+	int chunkRows;
+	const LevelChunkInfo *chunks;	// chunks[chunkRow * chunkCols + chunkCol]
+	const uint8_t *data;			// The whole file
+	size_t size;
+	void *handle;					// Platform mapping handle
+} LevelFile;
+
+LevelFile OpenLevelFile(const char *fileName);
+void CloseLevelFile(LevelFile level);
+bool IsLevelFileReady(LevelFile level);
+const LevelChunkInfo *GetLevelChunkInfo(const LevelFile *level, int chunkCol, int chunkRow);
+void ReadLevelChunk(const LevelFile *level, int chunkCol, int chunkRow, Map *map);
+void ReadLevelChunkCells(const LevelFile *level, int chunkCol, int chunkRow, MapCell *cells);
+void ReleaseLevelChunk(const LevelFile *level, int chunkCol, int chunkRow);
+Map LoadMapFromLevel(const LevelFile *level);
+Map LoadMapFromLevelFile(const char *fileName);
+bool ExportLevelFile(const Map *map, const char *fileName);
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "raylib.h"
+#include "occupancy.h"
+
+// Can something at from see to
+typedef struct SightQuery {
+	Vector2 from;
+	Vector2 to;
+} SightQuery;
+
+// Answers come back as bits, query i is bit (i % 64) of visible[i / 64]
+#define SIGHT_WORD_BITS 64
+#define GetSightWordCount(count) (((count) + SIGHT_WORD_BITS - 1) / SIGHT_WORD_BITS)
+
+static inline bool IsSightVisible(const uint64_t visible[], int index)
+{
+	return (visible[index / SIGHT_WORD_BITS] >> (index % SIGHT_WORD_BITS)) & 1;
+}
+
+bool CheckLineOfSight(const OccupancyGrid *grid, Vector2 from, Vector2 to, float *distance);
+void CheckLinesOfSight(const OccupancyGrid *grid, const SightQuery queries[], int count, uint64_t visible[], float distances[]);
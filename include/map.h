@@ -0,0 +1,186 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// One grid cell, 0 is open space and anything else is solid. Solid cells pick their wall texture,
+// CELL_WALL is the first one, CELL_WALL + 1 the second and so on.
+typedef uint8_t MapCell;
+
+#define CELL_EMPTY 0
+#define CELL_WALL 1
+
+// Floors and ceilings pick their texture like walls do, CELL_WALL is the first texture and so on.
+// SURFACE_DEFAULT leaves it to the renderer.
+#define SURFACE_DEFAULT 0
+
+// Maps are stored in square pages of cells that are allocated one by one. A page a map doesn't
+// store reads as wall, with default floors and ceilings, like the outside of the map.
+#define MAP_PAGE_SHIFT 6
+#define MAP_PAGE_SIZE (1 << MAP_PAGE_SHIFT)	// Cells along each side of a page, the same as a level chunk
+#define MAP_PAGE_MASK (MAP_PAGE_SIZE - 1)
+
+#define MAP_MAX_DIRTY_REGIONS 16	// More edits between commits get merged into the closest region
+#define MAP_MAX_LISTENERS 8
+
+// Rectangle of cells
+typedef struct MapRegion {
+	int col;
+	int row;
+	int width;
+	int height;
+} MapRegion;
+
+struct Map;
+
+// Called by CommitMapChanges() once for every region that changed
+typedef void (*MapListener)(const struct Map *map, MapRegion region, void *data);
+
+// Edits waiting for the next commit and who to tell about them. Lives outside the const view of a
+// map on purpose: readers that only hold a const Map * can still subscribe and unsubscribe, which
+// changes who gets told about edits but never the cells themselves.
+typedef struct MapChanges {
+	unsigned int version;	// Counts the commits that changed something
+	int dirtyCount;
+	MapRegion dirty[MAP_MAX_DIRTY_REGIONS];
+	int listenerCount;
+	MapListener listeners[MAP_MAX_LISTENERS];
+	void *listenerData[MAP_MAX_LISTENERS];
+} MapChanges;
+
+// MAP_PAGE_SIZE x MAP_PAGE_SIZE cells of a map, each array row by row. floors and ceilings hold
+// the texture of each open cell's floor and ceiling.
+typedef struct MapPage {
+	MapCell cells[MAP_PAGE_SIZE * MAP_PAGE_SIZE];
+	MapCell floors[MAP_PAGE_SIZE * MAP_PAGE_SIZE];
+	MapCell ceilings[MAP_PAGE_SIZE * MAP_PAGE_SIZE];
+} MapPage;
+
+// Heap allocated grid of cells split into pages, the cell at col, row is in
+// pages[(row / MAP_PAGE_SIZE) * pageCols + col / MAP_PAGE_SIZE]. Pages the map doesn't store all
+// point at one shared solid page, so a map only costs memory for the pages it stores. The map is
+// the one owner of the cell data, everything else reads it through a const Map * and learns about
+// edits by subscribing to it.
+typedef struct Map {
+	int width;
+	int height;
+	int pageCols;
+	int pageRows;
+	MapPage **pages;
+	MapChanges *changes;
+} Map;
+
+Map LoadMapEmpty(int width, int height);
+Map LoadMapSolid(int width, int height);
+Map LoadMapFromArray(const unsigned int *data, int width, int height);
+void UnloadMap(Map map);
+bool IsMapReady(Map map);
+
+MapPage *GetSolidMapPage();
+MapPage *LoadMapPage();
+void UnloadMapPage(MapPage *page);
+void StoreMapPage(Map *map, int pageCol, int pageRow, MapPage *page);
+bool IsMapPageStored(const Map *map, int pageCol, int pageRow);
+bool CopyMapPage(Map *target, const Map *source, int pageCol, int pageRow);
+void WriteMapCells(Map *map, int col, int row, const MapCell *cells, int count);
+
+void MarkMapRegionDirty(Map *map, int col, int row, int width, int height);
+void CommitMapChanges(Map *map);
+unsigned int GetMapVersion(const Map *map);
+void SubscribeMap(const Map *map, MapListener listener, void *data);
+void UnsubscribeMap(const Map *map, MapListener listener, void *data);
+
+/*
+ * Bounds-safe cell access. Everything outside the map reads as CELL_WALL so nothing can ever walk
+ * or cast off the grid, writes outside the map or to pages it doesn't store are ignored. Writes
+ * that change a cell mark it dirty, listeners hear about it on the next CommitMapChanges().
+ */
+static inline bool IsMapCellInside(const Map *map, int col, int row)
+{
+	return col >= 0 && row >= 0 && col < map->width && row < map->height;
+}
+
+// Page holding a cell inside the map, the shared solid page if the map doesn't store it
+static inline MapPage *GetMapPage(const Map *map, int col, int row)
+{
+	return map->pages[(long)(row >> MAP_PAGE_SHIFT) * map->pageCols + (col >> MAP_PAGE_SHIFT)];
+}
+
+// Index of a cell in the arrays of its page
+static inline int GetMapPageIndex(int col, int row)
+{
+	return ((row & MAP_PAGE_MASK) << MAP_PAGE_SHIFT) | (col & MAP_PAGE_MASK);
+}
+
+// Page a cell can be written to, NULL outside the map and for pages the map doesn't store
+static inline MapPage *GetWritableMapPage(Map *map, int col, int row)
+{
+	if (!IsMapCellInside(map, col, row)) { return NULL; }
+
+	MapPage *page = GetMapPage(map, col, row);
+	return page != GetSolidMapPage() ? page : NULL;
+}
+
+static inline MapCell GetMapCell(const Map *map, int col, int row)
+{
+	return IsMapCellInside(map, col, row) ? GetMapPage(map, col, row)->cells[GetMapPageIndex(col, row)] : CELL_WALL;
+}
+
+static inline bool IsMapWall(const Map *map, int col, int row)
+{
+	return GetMapCell(map, col, row) != CELL_EMPTY;
+}
+
+static inline void SetMapCell(Map *map, int col, int row, MapCell cell)
+{
+	MapPage *page = GetWritableMapPage(map, col, row);
+	if (page == NULL) { return; }
+
+	MapCell *target = &page->cells[GetMapPageIndex(col, row)];
+	if (*target != cell)
+	{
+		*target = cell;
+		MarkMapRegionDirty(map, col, row, 1, 1);
+	}
+}
+
+/*
+ * Floor and ceiling textures, same bounds rules as the cells. Outside the map and pages that
+ * aren't stored read as SURFACE_DEFAULT.
+ */
+static inline MapCell GetMapFloor(const Map *map, int col, int row)
+{
+	return IsMapCellInside(map, col, row) ? GetMapPage(map, col, row)->floors[GetMapPageIndex(col, row)] : SURFACE_DEFAULT;
+}
+
+static inline MapCell GetMapCeiling(const Map *map, int col, int row)
+{
+	return IsMapCellInside(map, col, row) ? GetMapPage(map, col, row)->ceilings[GetMapPageIndex(col, row)] : SURFACE_DEFAULT;
+}
+
+static inline void SetMapFloor(Map *map, int col, int row, MapCell floor)
+{
+	MapPage *page = GetWritableMapPage(map, col, row);
+	if (page == NULL) { return; }
+
+	MapCell *target = &page->floors[GetMapPageIndex(col, row)];
+	if (*target != floor)
+	{
+		*target = floor;
+		MarkMapRegionDirty(map, col, row, 1, 1);
+	}
+}
+
+static inline void SetMapCeiling(Map *map, int col, int row, MapCell ceiling)
+{
+	MapPage *page = GetWritableMapPage(map, col, row);
+	if (page == NULL) { return; }
+
+	MapCell *target = &page->ceilings[GetMapPageIndex(col, row)];
+	if (*target != ceiling)
+	{
+		*target = ceiling;
+		MarkMapRegionDirty(map, col, row, 1, 1);
+	}
+}
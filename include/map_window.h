@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include "raylib.h"
+#include "map.h"
+#include "occupancy.h"
+#include "distance_field.h"
+#include "floor_cast.h"
+#include "job_system.h"
+
+// Renderer side copies of the part of a map around the camera. All of them are sized by the window
+// instead of the map, so a huge streamed map costs no more than a small one. Outside the window
+// reads as wall, or SURFACE_DEFAULT for floors and ceilings.
+typedef struct MapWindow {
+	MapRegion region;	// Map cells covered, page aligned except where the map's edge clips it
+	OccupancyPyramid occupancy;
+	DistanceField distanceField;
+	SurfaceGrid surfaces;
+} MapWindow;
+
+// Keeps a MapWindow up to date on a background job so edits and camera moves never rebuild it on
+// the main thread. The job reads its own copy of the map's pages, which the main thread refreshes
+// before each job starts, and builds the next window for the main thread to swap in once it is done.
+typedef struct MapWindowBuilder {
+	Map snapshot;		// Copies of the pages in the window, only touched while no job runs
+	bool *stale;		// Per page of the map, set when the snapshot's copy may be out of date
+	MapWindow next;		// Built by the job, swapped with the shown window when it is done
+	MapRegion region;	// Cells next is built for
+	const MapWindow *shown;	// Window the job starts from when it covers the same region
+	int pendingCount;	// Regions changed since the running job started
+	MapRegion pending[MAP_MAX_DIRTY_REGIONS];
+	int jobCount;		// Regions the running job applies
+	MapRegion jobRegions[MAP_MAX_DIRTY_REGIONS];
+	JobCounter done;
+	bool running;
+} MapWindowBuilder;
+
+MapRegion GetMapWindowRegion(const Map *map, Vector2 position, int radius);
+MapWindow LoadMapWindow(const Map *map, MapRegion region);
+void UnloadMapWindow(MapWindow window);
+bool IsMapWindowReady(MapWindow window);
+void UpdateMapWindow(MapWindow *window, const Map *map, int col, int row, int width, int height);
+void UpdateMapWindowFromMap(MapWindow *window, const Map *map);
+
+MapWindowBuilder LoadMapWindowBuilder(const Map *map);
+void UnloadMapWindowBuilder(MapWindowBuilder *builder);
+bool IsMapWindowBuilderReady(const MapWindowBuilder *builder);
+void InvalidateMapWindowSnapshot(MapWindowBuilder *builder, MapRegion region);
+void QueueMapWindowChange(MapWindowBuilder *builder, MapRegion region);
+bool StartMapWindowBuild(MapWindowBuilder *builder, const Map *map, const MapWindow *shown, MapRegion region);
+bool FinishMapWindowBuild(MapWindowBuilder *builder, MapWindow *shown);
+void WaitMapWindowBuild(MapWindowBuilder *builder);
+bool IsMapWindowBuilding(const MapWindowBuilder *builder);
+
+static inline bool IsSameMapRegion(MapRegion a, MapRegion b)
+{
+	return a.col == b.col && a.row == b.row && a.width == b.width && a.height == b.height;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "map.h"
+
+// 1 bit per cell copy of the solidity of a window of a Map, set bits are walls. 64 cells of a row
+// share one word, an eighth of the memory of the cells themselves so ray casts stay in cache. The
+// grid covers width x height cells from the map cell col, row on, everything outside it reads as
+// wall like the outside of the map. The bits past the end of each row are set for the same reason.
+typedef struct OccupancyGrid {
+	int col;
+	int row;
+	int width;
+	int height;
+	int rowWords;		// Words per row in rows[]
+	uint64_t *rows;		// Bit (x % 64) of rows[y * rowWords + x / 64] for x, y counted from col, row
+} OccupancyGrid;
+
+#define OCCUPANCY_MAX_LEVELS 16
+
+// Coarse to fine copies of a map's occupancy. levels[0] has a bit per cell, every level above
+// halves both sides so a bit covers a 2^level x 2^level block and is only clear if the whole block
+// is open. Lets a ray jump across large open areas in one step. The cells of a level are the map
+// cells shifted right by the level, levels stop where the window's corner stops being a multiple.
+typedef struct OccupancyPyramid {
+	int levelCount;
+	OccupancyGrid levels[OCCUPANCY_MAX_LEVELS];
+} OccupancyPyramid;
+
+OccupancyGrid LoadOccupancyGrid(const Map *map, MapRegion window);
+void UnloadOccupancyGrid(OccupancyGrid grid);
+void UpdateOccupancyGrid(OccupancyGrid *grid, const Map *map, int col, int row, int width, int height);
+
+OccupancyPyramid LoadOccupancyPyramid(const Map *map, MapRegion window);
+void UnloadOccupancyPyramid(OccupancyPyramid pyramid);
+void UpdateOccupancyPyramid(OccupancyPyramid *pyramid, const Map *map, int col, int row, int width, int height);
+void UpdateOccupancyPyramidFromMap(OccupancyPyramid *pyramid, const Map *map);
+
+// Same rules as IsMapWall(), anything outside the grid is solid. col and row are map cells.
+static inline bool IsCellOccupied(const OccupancyGrid *grid, int col, int row)
+{
+	col -= grid->col;
+	row -= grid->row;
+	if (col < 0 || row < 0 || col >= grid->width || row >= grid->height) { return true; }
+	return (grid->rows[(long)row * grid->rowWords + (col >> 6)] >> (col & 63)) & 1;
+}
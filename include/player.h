@@ -1,6 +1,8 @@
 #pragma once
 
 #include "raylib.h"
+#include "map.h"
+#include "distance_field.h"
 
 typedef struct Player {
 	Vector2 position;
@@ -13,7 +15,8 @@ typedef struct Player {
 
 Player player;
 
-void CreatePlayer(Vector2 init_position, float init_rotation, float move_speed, float rotate_speed, float collider_radius, unsigned int map_data[10][10]);
-void UpdatePlayerMapData(unsigned int map_data[10][10]);
+void CreatePlayer(Vector2 init_position, float init_rotation, float move_speed, float rotate_speed, float collider_radius, const Map *map_data);
+void UpdatePlayerMapData(const Map *map_data);
+void UpdatePlayerDistanceField(const DistanceField *field);
 void PlayerInput();
 bool CanMove(Vector2 position);
\ No newline at end of file
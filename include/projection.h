@@ -0,0 +1,17 @@
+#pragma once
+
+#include "raylib.h"
+
+// Per-column ray data that only depends on the FOV and ray count, rebuilt when either changes.
+// Directions are relative to a camera facing +X, RotateProjectionTable() turns them into world space.
+typedef struct ProjectionTable {
+	unsigned int rayCount;
+	unsigned int fov;
+	float *castAngles;
+	Vector2 *directions;
+	float *corrections;
+} ProjectionTable;
+
+ProjectionTable LoadProjectionTable(unsigned int rayCount, unsigned int fov, unsigned int viewportWidth, float drawDistance);
+void UnloadProjectionTable(ProjectionTable table);
+void RotateProjectionTable(const ProjectionTable *table, float angleDegrees, Vector2 forward[]);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "renderer.h"
+#include "occupancy.h"
+
+void CastRaysPyramid(struct RayData rays[], const Vector2 forward[], const float correction[], int first, int count, Vector2 position, const OccupancyPyramid *pyramid, float maxDistance);
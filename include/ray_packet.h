@@ -0,0 +1,14 @@
+#pragma once
+
+#include "renderer.h"
+#include "occupancy.h"
+
+// Number of rays traversed together by CastRayPackets(). Picked once at runtime from the CPU features.
+typedef enum RayPacketWidth {
+	PACKET_SCALAR = 1,
+	PACKET_SSE = 4,
+	PACKET_AVX2 = 8
+} RayPacketWidth;
+
+RayPacketWidth GetRayPacketWidth();
+bool CastRayPackets(struct RayData rays[], const Vector2 forward[], const float correction[], int first, int count, Vector2 position, const OccupancyGrid *grid, float maxDistance);
@@ -1,10 +1,22 @@
 #pragma once
 
 #include "raylib.h"
+#include "software_renderer.h"
+#include "map.h"
+#include "distance_field.h"
+#include "occupancy.h"
+#include "texture_atlas.h"
+#include "wall_batch.h"
+#include "sprite.h"
+
+#define VIEWPORT_WIDTH 640
+#define VIEWPORT_HEIGHT 480
 
 typedef struct Renderer {
 	RenderTexture2D renderTex;
-	Texture2D textures[8];
+	TextureAtlas wallAtlas;
+	WallBatch wallBatch;	// Wall columns of the frame, drawn in one go
+	WallBatch spriteBatch;	// Visible sprite columns of the frame, drawn after the walls
 	float renderScale;
 	Vector2 virtualMouse;
 	Vector2 cameraPosition;
@@ -12,6 +24,11 @@ typedef struct Renderer {
 	Vector2 cameraForward;
 	unsigned int ray_count;
 	unsigned int column_pixel_width;
+	// Software backend, the framebuffer is uploaded to framebufferTex when there is a window
+	bool headless;
+	SoftwareFramebuffer framebuffer;
+	Texture2D framebufferTex;
+	SoftwareTexture softwareWalls;	// CPU copy of wallAtlas
 } Renderer;
 
 typedef enum DrawMode {
@@ -34,6 +51,19 @@ typedef enum RenderQuality {
 	ULTRA
 } RenderQuality;
 
+typedef enum TraversalMode {
+	DDA_SCALAR,
+	DDA_PACKET,
+	DDA_FIXED,
+	DDA_PYRAMID,
+	DDA_SPHERE
+} TraversalMode;
+
+typedef enum RenderBackend {
+	BACKEND_RAYLIB,
+	BACKEND_SOFTWARE
+} RenderBackend;
+
 typedef enum GameMode {
 	MAIN_MENU,
 	EDITOR,
@@ -48,13 +78,24 @@ typedef struct RayData {
 	bool hitX;
 	float castAngleRadians;
 	float offset;
+	MapCell cell;	// Wall the ray stopped at, CELL_EMPTY if it ran out of draw distance
+	int steps;		// Steps the traversal took for this ray, 0 if it was interpolated or cached
 } RayData;
 
-void CreateRenderer(bool fullscreen, bool vsync, unsigned int screenWidth, unsigned int screenHeight, unsigned int fov, unsigned int mapData[10][10]);
+void CreateRenderer(bool fullscreen, bool vsync, unsigned int screenWidth, unsigned int screenHeight, unsigned int fov, const Map *mapData);
+void CreateHeadlessRenderer(unsigned int fov, const Map *mapData);
 void LoadTextures();
 void UnloadTextures();
-void UpdateRendererMapData(unsigned int mapData[10][10]);
+void UpdateRendererMapData(const Map *mapData);
+void UpdateRendererMapRegion(int col, int row, int width, int height);
+void UpdateRendererMapWindow(int radius);
+const DistanceField *GetRendererDistanceField();
+const OccupancyGrid *GetRendererOccupancy();
+void UpdateRendererSprites(const Sprite spriteData[], int count);
+void UpdateRendererSprite(int index);
+int GetRendererTextureIndex(const char *fileName);
 void UpdateRenderingSettings(bool fullscreen, bool vsync, unsigned int screenWidth, unsigned int screenHeight, unsigned int fov);
+void UpdateProjection();
 
 void RendererInput();
 
@@ -64,6 +105,14 @@ void UpdateRenderCamera(Vector2 position, float rotation);
 void UpdateDrawMode(DrawMode newDrawMode);
 void UpdateShadingMode(ShadingMode newShadingMode);
 void UpdateRenderQuality(RenderQuality newRenderQuality);
+void UpdateTraversalMode(TraversalMode newTraversalMode);
+void UpdateCoherentRays(bool enabled);
+void UpdateRotationCache(bool enabled);
+void UpdateBatchedWalls(bool enabled);
+void UpdateRenderBackend(RenderBackend newRenderBackend);
+void MarkFrameDirty();
+const SoftwareFramebuffer *GetSoftwareFramebuffer();
+unsigned int GetRayCount();
 
 void DDA(struct RayData rays[], Vector2 position, float angle);
 void DDASingle(Vector2 position, float angle);
@@ -71,5 +120,7 @@ void DDANonLinear(struct RayData rays[], Vector2 position, float angle);
 
 void DrawDebug();
 void Draw2D(const struct RayData rays[]);
-void Draw3D(const struct RayData rays[], Texture2D tex);
+void Draw3D(const struct RayData rays[], const TextureAtlas *atlas);
+void Draw2DSoftware(const struct RayData rays[]);
+void Draw3DSoftware(const struct RayData rays[], const SoftwareTexture *tex, const TextureAtlas *atlas);
 void DrawMainMenu();
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include "raylib.h"
+
+// CPU owned image in PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 order, can be uploaded with UpdateTexture() as is
+typedef struct SoftwareFramebuffer {
+	int width;
+	int height;
+	uint32_t *pixels;
+} SoftwareFramebuffer;
+
+// CPU copy of a texture for sampling, same pixel layout as the framebuffer
+typedef struct SoftwareTexture {
+	int width;
+	int height;
+	uint32_t *pixels;
+} SoftwareTexture;
+
+SoftwareFramebuffer LoadSoftwareFramebuffer(int width, int height);
+void UnloadSoftwareFramebuffer(SoftwareFramebuffer framebuffer);
+SoftwareTexture LoadSoftwareTexture(const char *fileName);
+SoftwareTexture LoadSoftwareTextureFromImage(Image image);
+void UnloadSoftwareTexture(SoftwareTexture texture);
+
+uint32_t ColorToPixel(Color color);
+void SoftwareClear(SoftwareFramebuffer *framebuffer, Color color);
+void SoftwareDrawRectangle(SoftwareFramebuffer *framebuffer, int posX, int posY, int width, int height, Color color);
+void SoftwareDrawLine(SoftwareFramebuffer *framebuffer, int startPosX, int startPosY, int endPosX, int endPosY, Color color);
+void SoftwareDrawCircle(SoftwareFramebuffer *framebuffer, int centerX, int centerY, float radius, Color color);
+void SoftwareDrawTexturedColumn(SoftwareFramebuffer *framebuffer, const SoftwareTexture *texture, int posX, int width, float top, float height, float texX, float texStart, float texSpan, Color tint);
+void SoftwareDrawSpriteColumn(SoftwareFramebuffer *framebuffer, const SoftwareTexture *texture, int posX, int width, float top, float height, float texX, float texStart, float texSpan, Color tint);
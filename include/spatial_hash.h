@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include "raylib.h"
+
+#define SPATIAL_HASH_END -1	// No object, ends a cell's list
+
+// Where one object is filed
+typedef struct SpatialHashEntry {
+	int col;
+	int row;
+	int next;		// Neighbours in the same bucket
+	int prev;
+	bool inserted;
+} SpatialHashEntry;
+
+// Objects filed by the map cell they stand in, named by their index below capacity. Cells are
+// hashed into a power of 2 number of buckets, each a doubly linked list threaded through the
+// entries, so inserting, moving and removing are O(1) and memory grows with the number of objects
+// instead of the size of the map.
+typedef struct SpatialHash {
+	int capacity;
+	int bucketMask;
+	int *buckets;		// First object in each bucket
+	SpatialHashEntry *entries;
+} SpatialHash;
+
+SpatialHash LoadSpatialHash(int capacity);
+void UnloadSpatialHash(SpatialHash hash);
+void ClearSpatialHash(SpatialHash *hash);
+void InsertSpatialHash(SpatialHash *hash, int id, Vector2 position);
+void MoveSpatialHash(SpatialHash *hash, int id, Vector2 position);
+void RemoveSpatialHash(SpatialHash *hash, int id);
+int GetSpatialHashCellFirst(const SpatialHash *hash, int col, int row);
+int GetSpatialHashCellNext(const SpatialHash *hash, int id);
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "renderer.h"
+#include "occupancy.h"
+#include "distance_field.h"
+
+void CastRaysSphere(struct RayData rays[], const Vector2 forward[], const float correction[], int first, int count, Vector2 position, const DistanceField *field, const OccupancyGrid *grid, float maxDistance);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "raylib.h"
+
+// Billboard standing on the floor, always facing the camera
+typedef struct Sprite {
+	Vector2 position;
+	float size;			// Height and width in cells, 1 is as tall as a wall
+	int texture;		// Index into the renderer's texture atlas
+} Sprite;
+
+// Camera the sprites are projected for, matching the wall projection
+typedef struct SpriteView {
+	Vector2 position;
+	Vector2 forward;
+	float tanHalfFov;
+	float screenWidth;		// Pixels across the view
+	float horizon;			// Screen row of the horizon
+	float heightScale;		// Pixels tall a wall distance 1 away is
+	float nearDistance;		// Sprites closer than this are skipped
+	float farDistance;		// and so are sprites further than this
+} SpriteView;
+
+// A sprite after projection, sorted and drawn by the renderer
+typedef struct ProjectedSprite {
+	float depth;		// Distance along the view direction, same measure as RayData.distance
+	float left;			// Screen rect
+	float top;
+	float width;
+	float height;
+	int texture;
+} ProjectedSprite;
+
+int ProjectSprites(const Sprite sprites[], int count, const SpriteView *view, ProjectedSprite projected[]);
+void SortSpritesBackToFront(ProjectedSprite sprites[], ProjectedSprite scratch[], int count, float farDistance);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "raylib.h"
+
+#define ATLAS_MAX_TEXTURES 16
+
+// Several textures packed into one image so switching between them doesn't need a texture bind.
+// rects[i] is where texture i ended up, in atlas pixels.
+typedef struct TextureAtlas {
+	Image image;		// CPU copy in PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+	Texture2D texture;	// GPU copy, id is 0 until UploadTextureAtlas()
+	int count;
+	Rectangle rects[ATLAS_MAX_TEXTURES];
+} TextureAtlas;
+
+TextureAtlas LoadTextureAtlas(const char *const fileNames[], int count);
+void UploadTextureAtlas(TextureAtlas *atlas);
+void UnloadTextureAtlas(TextureAtlas atlas);
+Rectangle GetAtlasRect(const TextureAtlas *atlas, int index);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+#include "raylib.h"
+
+// One vertical edge of a wall segment on screen
+typedef struct WallEdge {
+	float x;
+	float top;
+	float bottom;
+	float u;		// Normalized texture x
+	float q;		// 1 / distance of the wall, anything proportional to it works
+	Color tint;
+} WallEdge;
+
+// Quads drawn together with a single draw call. Lives in GPU buffers that are allocated once and
+// overwritten every frame, with CPU side copies of the same size the quads are written into first.
+// Texture coordinates carry a perspective weight so a whole wall segment can be one quad.
+typedef struct WallBatch {
+	int capacity;			// Quads that fit
+	int count;				// Quads added since the last ClearWallBatch()
+	Vector2 *positions;		// 4 vertices per quad, top left, bottom left, bottom right, top right
+	Vector3 *texcoords;		// u * q, v * q, q
+	Color *colors;
+	Shader shader;			// Divides the texture coordinates by q per pixel
+	unsigned int vao;
+	unsigned int positionBuffer;
+	unsigned int texcoordBuffer;
+	unsigned int colorBuffer;
+	unsigned int indexBuffer;
+} WallBatch;
+
+WallBatch LoadWallBatch(int capacity);
+void UnloadWallBatch(WallBatch batch);
+bool IsWallBatchReady(WallBatch batch);
+void ClearWallBatch(WallBatch *batch);
+void AddWallSegment(WallBatch *batch, WallEdge left, WallEdge right, float v0, float v1);
+void DrawWallBatch(WallBatch *batch, unsigned int textureId);
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "raylib.h"
+#include "map.h"
+
+bool CreateWorldStream(const char *fileName, int chunkRadius, size_t memoryBudget);
+void DestroyWorldStream();
+Map *GetWorldStreamMap();
+void FillWorldStream(Vector2 position);
+void UpdateWorldStream(Vector2 position, Vector2 forward);
+bool IsWorldCellResident(int col, int row);
+int GetResidentChunkCount();
@@ -0,0 +1,263 @@
+#include "actor.h"
+#include "helpful_math.h"
+#include "collision.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define ACTOR_INDEX_MASK (ACTOR_MAX_CAPACITY - 1)
+// The arrays of a store never overlap, telling the compiler so lets it vectorize the passes of
+// UpdateActors(). Understood by gcc, clang and MSVC alike.
+#define RESTRICT __restrict
+// Per slot arrays are padded to a multiple of this many slots so the passes can always run whole
+// vectors, without a scalar tail the compiler would otherwise only vectorize at higher -O levels
+#define ACTOR_BATCH_WIDTH 8
+
+static ActorHandle MakeActorHandle(int index, uint16_t generation)
+{
+	return ((ActorHandle)generation << ACTOR_INDEX_BITS) | (ActorHandle)index;
+}
+
+/*
+ * Allocates room for capacity actors, at most ACTOR_MAX_CAPACITY. Returns a store with a capacity of
+ * 0 if that fails.
+ */
+ActorStore LoadActorStore(int capacity)
+{
+	ActorStore store = { 0 };
+	if (capacity <= 0 || capacity > ACTOR_MAX_CAPACITY) { return store; }
+
+	// Zeroed so the padding past the last live actor is harmless to run the passes over
+	const int padded = ((capacity + ACTOR_BATCH_WIDTH - 1) / ACTOR_BATCH_WIDTH) * ACTOR_BATCH_WIDTH;
+	store.positionX = calloc(padded, sizeof(float));
+	store.positionY = calloc(padded, sizeof(float));
+	store.rotation = calloc(padded, sizeof(float));
+	store.forwardX = calloc(padded, sizeof(float));
+	store.forwardY = calloc(padded, sizeof(float));
+	store.speed = calloc(padded, sizeof(float));
+	store.radius = calloc(padded, sizeof(float));
+	store.kind = calloc(padded, sizeof(uint8_t));
+	store.flags = calloc(padded, sizeof(uint8_t));
+	store.handles = calloc(padded, sizeof(ActorHandle));
+	store.slots = malloc(capacity * sizeof(int));
+	store.generations = malloc(capacity * sizeof(uint16_t));
+	store.nextFree = malloc(capacity * sizeof(int));
+	store.targetX = calloc(padded, sizeof(float));
+	store.targetY = calloc(padded, sizeof(float));
+	store.clearance = calloc(padded, sizeof(float));
+	store.nearWall = malloc(capacity * sizeof(int));
+	store.hits = malloc(padded * sizeof(uint8_t));
+	if (store.positionX == NULL || store.positionY == NULL || store.rotation == NULL || store.forwardX == NULL ||
+		store.forwardY == NULL || store.speed == NULL || store.radius == NULL || store.kind == NULL ||
+		store.flags == NULL || store.handles == NULL || store.slots == NULL || store.generations == NULL ||
+		store.nextFree == NULL || store.targetX == NULL || store.targetY == NULL || store.clearance == NULL ||
+		store.nearWall == NULL || store.hits == NULL)
+	{
+		UnloadActorStore(store);
+		return (ActorStore){ 0 };
+	}
+
+	store.capacity = capacity;
+	// Free list in index order, handles start at generation 1 so none of them is ACTOR_HANDLE_NONE
+	for (int i = 0; i < capacity; i++)
+	{
+		store.slots[i] = -1;
+		store.generations[i] = 1;
+		store.nextFree[i] = i + 1 < capacity ? i + 1 : -1;
+	}
+	store.freeHead = 0;
+	return store;
+}
+
+void UnloadActorStore(ActorStore store)
+{
+	free(store.positionX);
+	free(store.positionY);
+	free(store.rotation);
+	free(store.forwardX);
+	free(store.forwardY);
+	free(store.speed);
+	free(store.radius);
+	free(store.kind);
+	free(store.flags);
+	free(store.handles);
+	free(store.slots);
+	free(store.generations);
+	free(store.nextFree);
+	free(store.targetX);
+	free(store.targetY);
+	free(store.clearance);
+	free(store.nearWall);
+	free(store.hits);
+}
+
+/*
+ * Adds an actor and returns its handle, ACTOR_HANDLE_NONE if the store is full. Indices of
+ * despawned actors are reused first.
+ */
+ActorHandle SpawnActor(ActorStore *store, ActorKind kind, Vector2 position, float rotation, float speed, float radius)
+{
+	if (store->freeHead < 0) { return ACTOR_HANDLE_NONE; }
+
+	const int index = store->freeHead;
+	store->freeHead = store->nextFree[index];
+	const int slot = store->count++;
+	store->slots[index] = slot;
+	store->handles[slot] = MakeActorHandle(index, store->generations[index]);
+
+	store->positionX[slot] = position.x;
+	store->positionY[slot] = position.y;
+	store->speed[slot] = speed;
+	store->radius[slot] = radius;
+	store->kind[slot] = (uint8_t)kind;
+	store->flags[slot] = 0;
+	SetActorRotation(store, slot, rotation);
+	return store->handles[slot];
+}
+
+/*
+ * Slot of a live actor, -1 if the handle is stale or was never handed out. Only valid until the
+ * next DespawnActor().
+ */
+int GetActorSlot(const ActorStore *store, ActorHandle handle)
+{
+	const int index = (int)(handle & ACTOR_INDEX_MASK);
+	if (handle == ACTOR_HANDLE_NONE || index >= store->capacity) { return -1; }
+	if (store->slots[index] < 0 || store->handles[store->slots[index]] != handle) { return -1; }
+	return store->slots[index];
+}
+
+bool IsActorAlive(const ActorStore *store, ActorHandle handle)
+{
+	return GetActorSlot(store, handle) >= 0;
+}
+
+/*
+ * Removes an actor. The last actor moves into its slot to keep the slots packed, and its index goes
+ * back on the free list with a new generation.
+ */
+void DespawnActor(ActorStore *store, ActorHandle handle)
+{
+	const int slot = GetActorSlot(store, handle);
+	if (slot < 0) { return; }
+
+	const int last = --store->count;
+	if (slot != last)
+	{
+		store->positionX[slot] = store->positionX[last];
+		store->positionY[slot] = store->positionY[last];
+		store->rotation[slot] = store->rotation[last];
+		store->forwardX[slot] = store->forwardX[last];
+		store->forwardY[slot] = store->forwardY[last];
+		store->speed[slot] = store->speed[last];
+		store->radius[slot] = store->radius[last];
+		store->kind[slot] = store->kind[last];
+		store->flags[slot] = store->flags[last];
+		store->handles[slot] = store->handles[last];
+		store->slots[store->handles[slot] & ACTOR_INDEX_MASK] = slot;
+	}
+
+	const int index = (int)(handle & ACTOR_INDEX_MASK);
+	store->slots[index] = -1;
+	// Generation 0 is skipped so no handle is ever ACTOR_HANDLE_NONE
+	store->generations[index] = (uint16_t)((store->generations[index] + 1) & ((1 << (32 - ACTOR_INDEX_BITS)) - 1));
+	if (store->generations[index] == 0) { store->generations[index] = 1; }
+	store->nextFree[index] = store->freeHead;
+	store->freeHead = index;
+}
+
+void SetActorRotation(ActorStore *store, int slot, float rotation)
+{
+	const Vector2 forward = Vector2Forward(rotation);
+	store->rotation[slot] = rotation;
+	store->forwardX[slot] = forward.x;
+	store->forwardY[slot] = forward.y;
+}
+
+// Same as GetDistanceFieldClearance(), here so the batch doesn't make a call per actor
+static inline float GetClearance(const DistanceField *field, float x, float y)
+{
+	const int col = (int)floorf(x);
+	const int row = (int)floorf(y);
+	const int radius = GetDistanceFieldValue(field, col, row) - 1;
+
+	// No early out for walls, a branch per actor mispredicts more than the math costs
+	const float left = x - (float)(col - radius);
+	const float right = (float)(col + radius + 1) - x;
+	const float top = y - (float)(row - radius);
+	const float bottom = (float)(row + radius + 1) - y;
+	const float clearance = MIN(MIN(left, right), MIN(top, bottom));
+	return radius < 0 ? 0.0f : clearance;
+}
+
+// target = position + forward * speed * deltaTime, one axis of blocks * ACTOR_BATCH_WIDTH slots
+static void StepAxis(float *RESTRICT target, const float *RESTRICT position, const float *RESTRICT forward, const float *RESTRICT speed, float deltaTime, int blocks)
+{
+	for (int i = 0; i < blocks * ACTOR_BATCH_WIDTH; i++)
+	{
+		target[i] = position[i] + (forward[i] * speed[i] * deltaTime);
+	}
+}
+
+// Moves one axis of every actor with clearance to spare to its target. The clearance at the target
+// has to cover the collider plus the whole step, so no wall can be anywhere along the way.
+static void MoveClearAxis(float *RESTRICT position, const float *RESTRICT target, const float *RESTRICT clearance, const float *RESTRICT radius, const float *RESTRICT speed, float deltaTime, int blocks)
+{
+	for (int i = 0; i < blocks * ACTOR_BATCH_WIDTH; i++)
+	{
+		// Both loaded up front so the choice compiles to a blend instead of a branch
+		const float moved = target[i];
+		const float stayed = position[i];
+		position[i] = clearance[i] >= radius[i] + (fabsf(speed[i]) * deltaTime) ? moved : stayed;
+	}
+}
+
+static void FlagNearWalls(uint8_t *RESTRICT flags, const float *RESTRICT clearance, const float *RESTRICT radius, const float *RESTRICT speed, float deltaTime, int blocks)
+{
+	for (int i = 0; i < blocks * ACTOR_BATCH_WIDTH; i++)
+	{
+		const uint8_t blocked = clearance[i] >= radius[i] + (fabsf(speed[i]) * deltaTime) ? 0 : ACTOR_BLOCKED;
+		flags[i] = (flags[i] & ~ACTOR_BLOCKED) | blocked;
+	}
+}
+
+/*
+ * Moves every actor along its forward vector for deltaTime seconds. Runs as a few passes over the
+ * whole store instead of a call per actor: targets are worked out for everyone, then their
+ * clearance from the distance field, and actors with room to spare all move in one go. Only the
+ * ones close to a wall are swept against the map, together in one ResolveCircleMoves() batch. Those
+ * slide along the walls they hit and are flagged ACTOR_BLOCKED. field is optional, without it every
+ * actor is swept.
+ */
+void UpdateActors(ActorStore *store, const Map *map, const DistanceField *field, float deltaTime)
+{
+	const int count = store->count;
+	const int blocks = (count + ACTOR_BATCH_WIDTH - 1) / ACTOR_BATCH_WIDTH;
+	StepAxis(store->targetX, store->positionX, store->forwardX, store->speed, deltaTime, blocks);
+	StepAxis(store->targetY, store->positionY, store->forwardY, store->speed, deltaTime, blocks);
+
+	for (int i = 0; i < count; i++)
+	{
+		store->clearance[i] = field != NULL ? GetClearance(field, store->targetX[i], store->targetY[i]) : 0.0f;
+	}
+
+	MoveClearAxis(store->positionX, store->targetX, store->clearance, store->radius, store->speed, deltaTime, blocks);
+	MoveClearAxis(store->positionY, store->targetY, store->clearance, store->radius, store->speed, deltaTime, blocks);
+	FlagNearWalls(store->flags, store->clearance, store->radius, store->speed, deltaTime, blocks);
+
+	// Swept moves for the few near a wall
+	int nearWallCount = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (store->flags[i] & ACTOR_BLOCKED) { store->nearWall[nearWallCount++] = i; }
+	}
+	const CircleMoves moves = {
+		store->positionX, store->positionY, store->targetX, store->targetY, store->radius, store->hits
+	};
+	ResolveCircleMoves(map, NULL, moves, store->nearWall, nearWallCount);
+	for (int n = 0; n < nearWallCount; n++)
+	{
+		const int i = store->nearWall[n];
+		if (store->hits[i] == 0) { store->flags[i] &= ~ACTOR_BLOCKED; }
+	}
+}
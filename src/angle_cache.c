@@ -0,0 +1,115 @@
+#include "angle_cache.h"
+#include "helpful_math.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ANGLE_CACHE_MASK (ANGLE_CACHE_SIZE - 1)
+
+/*
+ * Allocates the cache and its sample directions. Nothing is cast until FillAngleCache().
+ */
+AngleCache LoadAngleCache()
+{
+	AngleCache cache = { 0 };
+	cache.directions = malloc(ANGLE_CACHE_SIZE * sizeof(Vector2));
+	cache.hits = malloc(ANGLE_CACHE_SIZE * sizeof(AngleCacheHit));
+	cache.cast = calloc(ANGLE_CACHE_SIZE, sizeof(bool));
+
+	for (int i = 0; i < ANGLE_CACHE_SIZE; i++)
+	{
+		const float angle = (float)i * (2.0f * PI / ANGLE_CACHE_SIZE);
+		cache.directions[i] = (Vector2){ cosf(angle), sinf(angle) };
+	}
+
+	return cache;
+}
+
+void UnloadAngleCache(AngleCache cache)
+{
+	free(cache.directions);
+	free(cache.hits);
+	free(cache.cast);
+}
+
+/*
+ * Forgets every cached hit, call when the camera moves to position or the map changes.
+ */
+void ResetAngleCache(AngleCache *cache, Vector2 position)
+{
+	cache->position = position;
+	memset(cache->cast, 0, ANGLE_CACHE_SIZE * sizeof(bool));
+}
+
+/*
+ * Plain grid DDA that only keeps which wall face the ray stopped at.
+ */
+static AngleCacheHit CastCacheRay(Vector2 position, Vector2 forward, const OccupancyGrid *grid, float maxDistance)
+{
+	const Vector2 step = { fabsf(1.0f / forward.x), fabsf(1.0f / forward.y) };
+	const int dirX = forward.x < 0 ? -1 : 1;
+	const int dirY = forward.y < 0 ? -1 : 1;
+
+	AngleCacheHit hit = { (int)position.x, (int)position.y, false, false };
+	Vector2 rayLength = {
+		(dirX < 0 ? position.x - (float)hit.col : (float)(hit.col + 1) - position.x) * step.x,
+		(dirY < 0 ? position.y - (float)hit.row : (float)(hit.row + 1) - position.y) * step.y
+	};
+
+	float distanceChecked = 0.0f;
+	while (!hit.hit && distanceChecked < maxDistance)
+	{
+		hit.hitX = rayLength.x < rayLength.y;
+		if (hit.hitX)
+		{
+			hit.col += dirX;
+			distanceChecked = rayLength.x;
+			rayLength.x += step.x;
+		}
+		else
+		{
+			hit.row += dirY;
+			distanceChecked = rayLength.y;
+			rayLength.y += step.y;
+		}
+
+		hit.hit = IsCellOccupied(grid, hit.col, hit.row);
+	}
+
+	return hit;
+}
+
+/*
+ * Casts every sample in [first, first + count) that isn't cached yet. The range wraps around the
+ * circle, first can be any index. Samples are only ever written by the call that casts them so
+ * separate ranges can be filled in parallel.
+ */
+void FillAngleCache(AngleCache *cache, int first, int count, const OccupancyGrid *grid, float maxDistance)
+{
+	for (int n = 0; n < count; n++)
+	{
+		const int i = (first + n) & ANGLE_CACHE_MASK;
+		if (!cache->cast[i])
+		{
+			cache->hits[i] = CastCacheRay(cache->position, cache->directions[i], grid, maxDistance);
+			cache->cast[i] = true;
+		}
+	}
+}
+
+// Sample at or just below angleRadians, any angle works
+int GetAngleCacheIndex(float angleRadians)
+{
+	return (int)floorf(angleRadians * (ANGLE_CACHE_SIZE / (2.0f * PI))) & ANGLE_CACHE_MASK;
+}
+
+/*
+ * What the camera did since the last frame. Only the position matters for cached hits, turning on
+ * the spot keeps every one of them valid.
+ */
+CameraMotion ClassifyCameraMotion(Vector2 lastPosition, float lastRotation, Vector2 position, float rotation)
+{
+	if (lastPosition.x != position.x || lastPosition.y != position.y) { return CAMERA_MOVING; }
+	if (lastRotation != rotation) { return CAMERA_ROTATING; }
+	return CAMERA_STILL;
+}
@@ -0,0 +1,129 @@
+#include "collision.h"
+#include "helpful_math.h"
+
+#include <math.h>
+#include <stddef.h>
+
+// Circles stop this far short of the cell they hit, so rounding never leaves them touching it and
+// the next move starts from a clean position
+#define COLLISION_SKIN 0.001f
+
+// Only CELL_EMPTY is open, used when no filter is given
+static const CollisionFilter defaultFilter = { .open = { [CELL_EMPTY] = true } };
+
+// Distance from value to the closest point of the cell [cell, cell + 1]
+static inline float GetDistanceToCell(float value, int cell)
+{
+	return MAX(MAX((float)cell - value, 0.0f), value - (float)(cell + 1));
+}
+
+/*
+ * Sweeps a circle along one axis from along to target and returns where it stops. across is the
+ * circle's centre on the other axis, which doesn't change. Every cell the circle's path crosses is
+ * looked at, so nothing is skipped however long the move. A blocking cell the circle meets side on
+ * stops it at the cell's face, one it only clips stops it where the circle touches the cell's
+ * corner, which lets circles slide past corners they barely graze. A circle that already overlaps a
+ * cell isn't pushed out, it just can't move any further into it.
+ */
+static inline float SweepCircleAxis(const Map *map, const CollisionFilter *filter, bool vertical, float along, float across, float target, float radius, bool *hit)
+{
+	if (target == along) { return along; }
+
+	const int dir = target > along ? 1 : -1;
+	const int acrossFirst = (int)floorf(across - radius);
+	const int acrossLast = (int)floorf(across + radius);
+	const int alongLast = (int)floorf(target + (dir * (radius + COLLISION_SKIN)));
+	float limit = target;
+
+	// Cells ahead of the one the centre is in, nearest first
+	for (int cell = (int)floorf(along) + dir; dir > 0 ? cell <= alongLast : cell >= alongLast; cell += dir)
+	{
+		// Face of this column of cells the circle would meet
+		const float face = dir > 0 ? (float)cell : (float)(cell + 1);
+		// Nothing in this column or past it can stop the circle sooner
+		if ((face - (dir * (radius + COLLISION_SKIN)) - limit) * dir > 0.0f) { break; }
+
+		for (int other = acrossFirst; other <= acrossLast; other++)
+		{
+			const float gap = GetDistanceToCell(across, other);
+			if (gap >= radius) { continue; }
+
+			const MapCell value = vertical ? GetMapCell(map, other, cell) : GetMapCell(map, cell, other);
+			if (filter->open[value]) { continue; }
+
+			// How far short of the face the centre is when the circle first touches the cell
+			const float reach = sqrtf((radius * radius) - (gap * gap)) + COLLISION_SKIN;
+			const float contact = face - (dir * reach);
+			limit = dir > 0 ? MIN(limit, contact) : MAX(limit, contact);
+		}
+	}
+
+	// Never backwards, a circle already touching a cell stays put
+	limit = dir > 0 ? MAX(limit, along) : MIN(limit, along);
+	*hit = limit != target;
+	return limit;
+}
+
+// One circle, x then y, each axis starting from where the last one stopped so blocked moves slide
+static inline uint8_t ResolveCircleMove(const Map *map, const CollisionFilter *filter, float *x, float *y, float targetX, float targetY, float radius)
+{
+	bool hitX = false;
+	bool hitY = false;
+	*x = SweepCircleAxis(map, filter, false, *x, *y, targetX, radius, &hitX);
+	*y = SweepCircleAxis(map, filter, true, *y, *x, targetY, radius, &hitY);
+	return (hitX ? COLLISION_HIT_X : 0) | (hitY ? COLLISION_HIT_Y : 0);
+}
+
+/*
+ * Moves a batch of circles towards their targets, stopping each axis at the first cell that blocks
+ * it and sliding along whatever it hit with the rest of the move. indices picks which entries of
+ * moves to resolve, NULL resolves entries 0 to count - 1. filter picks the cells that block, NULL
+ * blocks everything but CELL_EMPTY. One call for the whole batch, so the map, filter and arrays are
+ * looked up once instead of per circle.
+ */
+void ResolveCircleMoves(const Map *map, const CollisionFilter *filter, CircleMoves moves, const int *indices, int count)
+{
+	if (filter == NULL) { filter = &defaultFilter; }
+
+	for (int n = 0; n < count; n++)
+	{
+		const int i = indices != NULL ? indices[n] : n;
+		const uint8_t hits = ResolveCircleMove(map, filter, &moves.positionX[i], &moves.positionY[i], moves.targetX[i], moves.targetY[i], moves.radius[i]);
+		if (moves.hits != NULL) { moves.hits[i] = hits; }
+	}
+}
+
+/*
+ * Single circle version of ResolveCircleMoves(), returns where the circle stopped. hits is optional.
+ */
+Vector2 MoveCircle(const Map *map, const CollisionFilter *filter, Vector2 position, Vector2 target, float radius, uint8_t *hits)
+{
+	if (filter == NULL) { filter = &defaultFilter; }
+
+	const uint8_t hit = ResolveCircleMove(map, filter, &position.x, &position.y, target.x, target.y, radius);
+	if (hits != NULL) { *hits = hit; }
+	return position;
+}
+
+/*
+ * True if the circle doesn't overlap any blocking cell, tested against the closest point of every
+ * cell it could touch so diagonal neighbours count too.
+ */
+bool IsCircleClear(const Map *map, const CollisionFilter *filter, Vector2 position, float radius)
+{
+	if (filter == NULL) { filter = &defaultFilter; }
+
+	for (int row = (int)floorf(position.y - radius); row <= (int)floorf(position.y + radius); row++)
+	{
+		const float dy = GetDistanceToCell(position.y, row);
+		for (int col = (int)floorf(position.x - radius); col <= (int)floorf(position.x + radius); col++)
+		{
+			const float dx = GetDistanceToCell(position.x, col);
+			if (!filter->open[GetMapCell(map, col, row)] && (dx * dx) + (dy * dy) < radius * radius)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
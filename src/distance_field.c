@@ -0,0 +1,109 @@
+#include "distance_field.h"
+#include "helpful_math.h"
+
+#include <stdlib.h>
+
+/*
+ * Allocates and fills the field for the cells of window, pass the whole map for all of it. Returns
+ * a field with no distances if the map isn't loaded, the window is empty or the allocation fails.
+ */
+DistanceField LoadDistanceField(const Map *map, MapRegion window)
+{
+	DistanceField field = { 0 };
+	if (!IsMapReady(*map) || window.width <= 0 || window.height <= 0) { return field; }
+
+	field.distances = malloc((size_t)window.width * window.height);
+	if (field.distances == NULL) { return field; }
+	field.col = window.col;
+	field.row = window.row;
+	field.width = window.width;
+	field.height = window.height;
+
+	UpdateDistanceField(&field, map, field.col, field.row, field.width, field.height);
+	return field;
+}
+
+void UnloadDistanceField(DistanceField field)
+{
+	free(field.distances);
+}
+
+// Neighbour distance plus the one step to reach it, capped. col and row are the field's own cells.
+static int StepFrom(const DistanceField *field, int col, int row)
+{
+	return MIN(GetDistanceFieldValue(field, field->col + col, field->row + row) + 1, DISTANCE_FIELD_MAX);
+}
+
+/*
+ * Recomputes the field after the map cells in the given rectangle changed. Distances are capped so
+ * an edit can only affect cells up to DISTANCE_FIELD_MAX away, only that area is rebuilt, clipped
+ * to the field. Cells just outside the area keep their (still correct) distances and seed the ones
+ * inside.
+ *
+ * Uses the two pass chamfer transform with a 3x3 mask, which is exact for Chebyshev distance. The
+ * first pass carries distances down and right from the walls, the second up and left.
+ */
+void UpdateDistanceField(DistanceField *field, const Map *map, int col, int row, int width, int height)
+{
+	// Loops run over the field's own cells, the map and neighbour lookups add the origin back
+	const int firstCol = MAX(col - field->col - DISTANCE_FIELD_MAX, 0);
+	const int firstRow = MAX(row - field->row - DISTANCE_FIELD_MAX, 0);
+	const int lastCol = MIN(col - field->col + width + DISTANCE_FIELD_MAX, field->width) - 1;
+	const int lastRow = MIN(row - field->row + height + DISTANCE_FIELD_MAX, field->height) - 1;
+	const int originCol = field->col;
+	const int originRow = field->row;
+
+	for (int y = firstRow; y <= lastRow; y++)
+	{
+		for (int x = firstCol; x <= lastCol; x++)
+		{
+			field->distances[(size_t)y * field->width + x] = IsMapWall(map, originCol + x, originRow + y) ? 0 : DISTANCE_FIELD_MAX;
+		}
+	}
+
+	for (int y = firstRow; y <= lastRow; y++)
+	{
+		for (int x = firstCol; x <= lastCol; x++)
+		{
+			uint8_t *distance = &field->distances[(size_t)y * field->width + x];
+			int d = *distance;
+			d = MIN(d, StepFrom(field, x - 1, y));
+			d = MIN(d, StepFrom(field, x - 1, y - 1));
+			d = MIN(d, StepFrom(field, x, y - 1));
+			d = MIN(d, StepFrom(field, x + 1, y - 1));
+			*distance = (uint8_t)d;
+		}
+	}
+
+	for (int y = lastRow; y >= firstRow; y--)
+	{
+		for (int x = lastCol; x >= firstCol; x--)
+		{
+			uint8_t *distance = &field->distances[(size_t)y * field->width + x];
+			int d = *distance;
+			d = MIN(d, StepFrom(field, x + 1, y));
+			d = MIN(d, StepFrom(field, x + 1, y + 1));
+			d = MIN(d, StepFrom(field, x, y + 1));
+			d = MIN(d, StepFrom(field, x - 1, y + 1));
+			*distance = (uint8_t)d;
+		}
+	}
+}
+
+/*
+ * Lower bound on the distance from position to the nearest wall, from the open square around its
+ * cell. Constant time, good for quick "is anything in reach" checks before exact collision tests.
+ */
+float GetDistanceFieldClearance(const DistanceField *field, Vector2 position)
+{
+	const int col = (int)floorf(position.x);
+	const int row = (int)floorf(position.y);
+	const int radius = GetDistanceFieldValue(field, col, row) - 1;
+	if (radius < 0) { return 0.0f; }
+
+	const float left = position.x - (float)(col - radius);
+	const float right = (float)(col + radius + 1) - position.x;
+	const float top = position.y - (float)(row - radius);
+	const float bottom = (float)(row + radius + 1) - position.y;
+	return MIN(MIN(left, right), MIN(top, bottom));
+}
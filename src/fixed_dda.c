@@ -0,0 +1,191 @@
+#include "fixed_dda.h"
+
+// Largest step/tangent stored in the tables, keeps every sum in the DDA loop inside 32 bits
+#define FIXED_MAX_STEP (1024 * FIXED_ONE)
+// pi / 2 in 2.30 fixed point, only used while building the tables
+#define HALF_PI_Q30 1686629713LL
+
+// sin covers a full turn plus a quarter so cos(a) is just sin(a + ANGLE_QUARTER)
+static Fixed sinTable[ANGLE_COUNT + ANGLE_QUARTER];
+static Fixed tanTable[ANGLE_COUNT];
+// |1 / cos| and |1 / sin|, the distance along the ray between two grid lines on each axis
+static Fixed secTable[ANGLE_COUNT];
+static Fixed cscTable[ANGLE_COUNT];
+static bool tablesReady = false;
+
+/*
+ * sin(x) for x in [0, pi / 2] given in 2.30 fixed point. Uses the Taylor series on integers only
+ * so the tables come out bit identical on every compiler and platform, unlike libm.
+ */
+static int64_t IntegerSinQ30(int64_t x)
+{
+	int64_t sum = x;
+	int64_t term = x;
+	for (int k = 1; term != 0; k++)
+	{
+		term = ((term * x) >> 30) * x >> 30;
+		term /= (2 * k) * (2 * k + 1);
+		sum += (k & 1) ? -term : term;
+	}
+	return sum;
+}
+
+static Fixed ClampStep(int64_t value)
+{
+	if (value > FIXED_MAX_STEP) { return FIXED_MAX_STEP; }
+	if (value < -FIXED_MAX_STEP) { return -FIXED_MAX_STEP; }
+	return (Fixed)value;
+}
+
+/*
+ * Fills the sin/cos/tan tables along with the per axis step tables. Only the first quarter turn
+ * is computed, the rest comes from symmetry.
+ */
+void InitFixedTables()
+{
+	if (tablesReady) { return; }
+
+	for (int i = 0; i <= ANGLE_QUARTER; i++)
+	{
+		int64_t x = (HALF_PI_Q30 * i) / ANGLE_QUARTER;
+		Fixed value = (Fixed)((IntegerSinQ30(x) + (1 << 13)) >> 14);	// Round 2.30 down to 16.16
+		sinTable[i] = value;
+		sinTable[(ANGLE_COUNT / 2) - i] = value;
+		sinTable[(ANGLE_COUNT / 2) + i] = -value;
+		sinTable[(ANGLE_COUNT - i) & ANGLE_MASK] = -value;
+	}
+	for (int i = ANGLE_COUNT; i < ANGLE_COUNT + ANGLE_QUARTER; i++)
+	{
+		sinTable[i] = sinTable[i - ANGLE_COUNT];
+	}
+
+	for (int i = 0; i < ANGLE_COUNT; i++)
+	{
+		int64_t s = sinTable[i];
+		int64_t c = sinTable[i + ANGLE_QUARTER];
+		tanTable[i] = c == 0 ? (s < 0 ? -FIXED_MAX_STEP : FIXED_MAX_STEP) : ClampStep((s * FIXED_ONE) / c);
+		secTable[i] = c == 0 ? FIXED_MAX_STEP : ClampStep(((int64_t)FIXED_ONE << FIXED_SHIFT) / (c < 0 ? -c : c));
+		cscTable[i] = s == 0 ? FIXED_MAX_STEP : ClampStep(((int64_t)FIXED_ONE << FIXED_SHIFT) / (s < 0 ? -s : s));
+	}
+
+	tablesReady = true;
+}
+
+Fixed FloatToFixed(float value) { return (Fixed)(value * (float)FIXED_ONE); }
+
+float FixedToFloat(Fixed value) { return (float)value / (float)FIXED_ONE; }
+
+Fixed FixedMul(Fixed a, Fixed b) { return (Fixed)(((int64_t)a * b) >> FIXED_SHIFT); }
+
+BinaryAngle DegreesToBinaryAngle(float degrees)
+{
+	return (BinaryAngle)(degrees * ((float)ANGLE_COUNT / 360.0f)) & ANGLE_MASK;
+}
+
+Fixed FixedSin(BinaryAngle angle) { return sinTable[angle & ANGLE_MASK]; }
+
+Fixed FixedCos(BinaryAngle angle) { return sinTable[(angle & ANGLE_MASK) + ANGLE_QUARTER]; }
+
+Fixed FixedTan(BinaryAngle angle) { return tanTable[angle & ANGLE_MASK]; }
+
+/*
+ * Same non-linear column spacing as the projection table, but found purely from the tan table.
+ * The projection plane x of each column divided by the draw distance is tan of its cast angle,
+ * so the angle is a binary search over tan between -90 and 90 degrees.
+ */
+void BuildFixedColumnAngles(BinaryAngle columnAngles[], unsigned int rayCount, unsigned int fov, unsigned int viewportWidth)
+{
+	InitFixedTables();
+
+	const int64_t xMax = viewportWidth - 1;
+	const Fixed tanHalfFov = FixedTan(((fov / 2) * ANGLE_COUNT) / 360);
+	const unsigned int xPixelWidth = viewportWidth / rayCount;
+	const unsigned int half_ray_count = rayCount / 2;
+
+	for (unsigned int i = 0; i <= half_ray_count; i++)
+	{
+		int64_t xScreen = i * xPixelWidth;
+		Fixed ratio = (Fixed)(((xScreen * 2 - xMax) * tanHalfFov) / xMax);
+
+		// Smallest angle whose tangent reaches the ratio, then take whichever neighbour is closer
+		BinaryAngle low = -ANGLE_QUARTER + 1;
+		BinaryAngle high = ANGLE_QUARTER - 1;
+		while (low < high)
+		{
+			BinaryAngle middle = low + ((high - low) >> 1);
+			if (FixedTan(middle) < ratio) { low = middle + 1; }
+			else { high = middle; }
+		}
+		if (low > -ANGLE_QUARTER + 1 && ratio - FixedTan(low - 1) < FixedTan(low) - ratio) { low--; }
+
+		columnAngles[i] = low;
+		columnAngles[rayCount - i] = -low;
+	}
+}
+
+/*
+ * Wolf3D style traversal: positions and distances are 16.16 fixed point and every direction,
+ * step and correction comes from the binary angle tables, so the inner loop is integer adds and
+ * compares only. Given the same inputs this produces bit identical hits on every platform, the
+ * floats written to rays[] are only converted at the very end for drawing.
+ */
+void CastRaysFixed(struct RayData rays[], const BinaryAngle columnAngles[], int first, int count, Vector2 position, float angleDegrees, const OccupancyGrid *grid, unsigned int drawDistance)
+{
+	const Fixed posX = FloatToFixed(position.x);
+	const Fixed posY = FloatToFixed(position.y);
+	const Fixed maxDistance = (Fixed)drawDistance << FIXED_SHIFT;
+	const BinaryAngle cameraAngle = DegreesToBinaryAngle(angleDegrees);
+
+	for (int i = first; i < first + count; i++)
+	{
+		const BinaryAngle angle = (cameraAngle + columnAngles[i]) & ANGLE_MASK;
+		const Fixed cosA = FixedCos(angle);
+		const Fixed sinA = FixedSin(angle);
+		const Fixed stepX = secTable[angle];
+		const Fixed stepY = cscTable[angle];
+
+		// Convert fixed point coords into map grid coords
+		int mapCol = posX >> FIXED_SHIFT;
+		int mapRow = posY >> FIXED_SHIFT;
+		const int dirX = cosA < 0 ? -1 : 1;
+		const int dirY = sinA < 0 ? -1 : 1;
+		Fixed rayLengthX = FixedMul(cosA < 0 ? (posX & (FIXED_ONE - 1)) : FIXED_ONE - (posX & (FIXED_ONE - 1)), stepX);
+		Fixed rayLengthY = FixedMul(sinA < 0 ? (posY & (FIXED_ONE - 1)) : FIXED_ONE - (posY & (FIXED_ONE - 1)), stepY);
+
+		bool hitWall = false;
+		bool hitX = false;
+		Fixed distanceChecked = 0;
+		int steps = 0;
+		while (!hitWall && distanceChecked < maxDistance)
+		{
+			steps++;
+			// Step along shortest length
+			if (rayLengthX < rayLengthY)
+			{
+				mapCol += dirX;
+				distanceChecked = rayLengthX;
+				rayLengthX += stepX;
+				hitX = true;
+			}
+			else
+			{
+				mapRow += dirY;
+				distanceChecked = rayLengthY;
+				rayLengthY += stepY;
+				hitX = false;
+			}
+
+			hitWall = IsCellOccupied(grid, mapCol, mapRow);
+		}
+
+		const Fixed endX = posX + FixedMul(distanceChecked, cosA);
+		const Fixed endY = posY + FixedMul(distanceChecked, sinA);
+
+		rays[i].start = position;
+		rays[i].end = (Vector2){ FixedToFloat(endX), FixedToFloat(endY) };
+		rays[i].hitX = hitX;
+		rays[i].distance = FixedToFloat(FixedMul(distanceChecked, FixedCos(columnAngles[i])));
+		rays[i].offset = FixedToFloat((hitX ? endY : endX) & (FIXED_ONE - 1));
+		rays[i].steps = steps;
+	}
+}
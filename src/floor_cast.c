@@ -0,0 +1,279 @@
+#include "floor_cast.h"
+#include "helpful_math.h"
+#include "ray_packet.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define FLOOR_CAST_X86
+	#include <immintrin.h>
+#endif
+
+// GCC and Clang only emit vector instructions for functions that ask for them, MSVC always allows them
+#if defined(__GNUC__) || defined(__clang__)
+	#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+	#define TARGET_AVX2
+#endif
+
+/*
+ * Copies the floors and ceilings of the cells of window, pass the whole map for all of it. Returns
+ * an empty grid if the map isn't loaded, the window is empty or an allocation fails.
+ */
+SurfaceGrid LoadSurfaceGrid(const Map *map, MapRegion window)
+{
+	SurfaceGrid grid = { 0 };
+	if (!IsMapReady(*map) || window.width <= 0 || window.height <= 0) { return grid; }
+
+	const size_t cellCount = (size_t)window.width * window.height;
+	grid.floors = calloc(cellCount + SURFACE_GRID_PADDING, 1);
+	grid.ceilings = calloc(cellCount + SURFACE_GRID_PADDING, 1);
+	if (grid.floors == NULL || grid.ceilings == NULL)
+	{
+		UnloadSurfaceGrid(grid);
+		return (SurfaceGrid){ 0 };
+	}
+	grid.col = window.col;
+	grid.row = window.row;
+	grid.width = window.width;
+	grid.height = window.height;
+
+	UpdateSurfaceGrid(&grid, map, grid.col, grid.row, grid.width, grid.height);
+	return grid;
+}
+
+void UnloadSurfaceGrid(SurfaceGrid grid)
+{
+	free(grid.floors);
+	free(grid.ceilings);
+}
+
+/*
+ * Copies the floors and ceilings of a rectangle of map cells, the part outside the grid is skipped.
+ */
+void UpdateSurfaceGrid(SurfaceGrid *grid, const Map *map, int col, int row, int width, int height)
+{
+	const int lastCol = MIN(col + width, grid->col + grid->width);
+	const int lastRow = MIN(row + height, grid->row + grid->height);
+	for (int y = MAX(row, grid->row); y < lastRow; y++)
+	{
+		const size_t line = (size_t)(y - grid->row) * grid->width;
+		for (int x = MAX(col, grid->col); x < lastCol; x++)
+		{
+			grid->floors[line + (x - grid->col)] = GetMapFloor(map, x, y);
+			grid->ceilings[line + (x - grid->col)] = GetMapCeiling(map, x, y);
+		}
+	}
+}
+
+// Rect of atlas texture index in whole texels, an empty rect when there is no such texture
+static SurfaceTexture GetSurfaceTexture(const TextureAtlas *atlas, int index)
+{
+	const Rectangle rect = GetAtlasRect(atlas, index);
+	return (SurfaceTexture){ (int)rect.x, (int)rect.y, (int)rect.width, (int)rect.height };
+}
+
+/*
+ * Looks up the atlas rect of every floor and ceiling value once so casting doesn't have to. Values
+ * pick textures like wall cells do, wrapping around the first textureCount atlas entries so they
+ * never reach the sprite textures after them. SURFACE_DEFAULT gets the default texture indexes given.
+ */
+void BuildSurfaceTextures(SurfaceTextures *surfaces, const TextureAtlas *atlas, int textureCount, int defaultFloor, int defaultCeiling)
+{
+	textureCount = MIN(textureCount, atlas->count);
+	surfaces->floors[SURFACE_DEFAULT] = GetSurfaceTexture(atlas, defaultFloor);
+	surfaces->ceilings[SURFACE_DEFAULT] = GetSurfaceTexture(atlas, defaultCeiling);
+	for (int value = CELL_WALL; value < 256; value++)
+	{
+		const int index = textureCount > 0 ? (value - CELL_WALL) % textureCount : 0;
+		surfaces->floors[value] = GetSurfaceTexture(atlas, index);
+		surfaces->ceilings[value] = surfaces->floors[value];
+	}
+}
+
+// Texel of surface at the fractional position u, v within its cell, both 0.16 fixed point
+static inline uint32_t FetchSurfaceTexel(const SoftwareTexture *atlas, const SurfaceTexture *surface, uint32_t u, uint32_t v)
+{
+	const uint32_t x = (u * (uint32_t)surface->width) >> 16;
+	const uint32_t y = (v * (uint32_t)surface->height) >> 16;
+	return atlas->pixels[((size_t)(surface->y + y) * atlas->width) + surface->x + x];
+}
+
+// Floor and ceiling value of the cell under the 16.16 fixed point position x, y
+static inline void GetSurfaceCell(const SurfaceGrid *grid, int32_t x, int32_t y, MapCell *floor, MapCell *ceiling)
+{
+	const int col = (x >> 16) - grid->col;
+	const int row = (y >> 16) - grid->row;
+	*floor = SURFACE_DEFAULT;
+	*ceiling = SURFACE_DEFAULT;
+	if ((unsigned int)col < (unsigned int)grid->width && (unsigned int)row < (unsigned int)grid->height)
+	{
+		const size_t cell = ((size_t)row * grid->width) + col;
+		*floor = grid->floors[cell];
+		*ceiling = grid->ceilings[cell];
+	}
+}
+
+#if defined(FLOOR_CAST_X86)
+
+// FetchSurfaceTexel() for 8 lanes, each with its own surface value. The surface's rect is gathered
+// from textures, read as 4 ints per value, then the texel from the atlas.
+TARGET_AVX2 static inline __m256i GatherSurfaceTexels(const SoftwareTexture *atlas, const SurfaceTexture *textures, __m256i value, __m256i u, __m256i v)
+{
+	const int *rects = (const int *)textures;
+	const __m256i index = _mm256_slli_epi32(value, 2);
+	const __m256i rectX = _mm256_i32gather_epi32(rects, index, 4);
+	const __m256i rectY = _mm256_i32gather_epi32(rects + 1, index, 4);
+	const __m256i width = _mm256_i32gather_epi32(rects + 2, index, 4);
+	const __m256i height = _mm256_i32gather_epi32(rects + 3, index, 4);
+	const __m256i x = _mm256_add_epi32(rectX, _mm256_srli_epi32(_mm256_mullo_epi32(u, width), 16));
+	const __m256i y = _mm256_add_epi32(rectY, _mm256_srli_epi32(_mm256_mullo_epi32(v, height), 16));
+	const __m256i texel = _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(atlas->width)), x);
+	return _mm256_i32gather_epi32((const int *)atlas->pixels, texel, 4);
+}
+
+/*
+ * Same as the scalar loop of CastFloorRows() for 8 blocks at a time. Each step gathers the floor
+ * and ceiling values of 8 cells, then the 8 floor and 8 ceiling texels. Cells outside the grid are
+ * masked out of the gather and read as SURFACE_DEFAULT. Returns how many blocks it did, a multiple
+ * of 8, the scalar loop finishes the rest.
+ */
+TARGET_AVX2 static int CastFloorBlocksAVX2(uint32_t *floorRow, uint32_t *ceilingRow, int rowWidth, int blockWidth, int blockCount, int32_t x, int32_t y, int32_t stepX, int32_t stepY, const SurfaceGrid *grid, const SurfaceTextures *surfaces, const SoftwareTexture *atlas)
+{
+	const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i stepX8 = _mm256_set1_epi32((int32_t)((uint32_t)stepX * 8));
+	const __m256i stepY8 = _mm256_set1_epi32((int32_t)((uint32_t)stepY * 8));
+	const __m256i originCol = _mm256_set1_epi32(grid->col);
+	const __m256i originRow = _mm256_set1_epi32(grid->row);
+	const __m256i width = _mm256_set1_epi32(grid->width);
+	const __m256i height = _mm256_set1_epi32(grid->height);
+	const __m256i minusOne = _mm256_set1_epi32(-1);
+	const __m256i fraction = _mm256_set1_epi32(0xFFFF);
+	const __m256i byte = _mm256_set1_epi32(0xFF);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i laneX = _mm256_add_epi32(_mm256_set1_epi32(x), _mm256_mullo_epi32(lane, _mm256_set1_epi32(stepX)));
+	__m256i laneY = _mm256_add_epi32(_mm256_set1_epi32(y), _mm256_mullo_epi32(lane, _mm256_set1_epi32(stepY)));
+
+	int block = 0;
+	for (; block + 8 <= blockCount; block += 8)
+	{
+		const __m256i col = _mm256_sub_epi32(_mm256_srai_epi32(laneX, 16), originCol);
+		const __m256i row = _mm256_sub_epi32(_mm256_srai_epi32(laneY, 16), originRow);
+		const __m256i inside = _mm256_and_si256(
+			_mm256_and_si256(_mm256_cmpgt_epi32(col, minusOne), _mm256_cmpgt_epi32(width, col)),
+			_mm256_and_si256(_mm256_cmpgt_epi32(row, minusOne), _mm256_cmpgt_epi32(height, row))
+		);
+		// One byte per cell, each lane reads the word starting at its cell and keeps the low byte
+		const __m256i cell = _mm256_add_epi32(_mm256_mullo_epi32(row, width), col);
+		const __m256i floors = _mm256_and_si256(_mm256_mask_i32gather_epi32(zero, (const int *)grid->floors, cell, inside, 1), byte);
+		const __m256i ceilings = _mm256_and_si256(_mm256_mask_i32gather_epi32(zero, (const int *)grid->ceilings, cell, inside, 1), byte);
+		const __m256i u = _mm256_and_si256(laneX, fraction);
+		const __m256i v = _mm256_and_si256(laneY, fraction);
+		const __m256i floorTexels = GatherSurfaceTexels(atlas, surfaces->floors, floors, u, v);
+		const __m256i ceilingTexels = GatherSurfaceTexels(atlas, surfaces->ceilings, ceilings, u, v);
+		laneX = _mm256_add_epi32(laneX, stepX8);
+		laneY = _mm256_add_epi32(laneY, stepY8);
+
+		if (blockWidth == 1)
+		{
+			_mm256_storeu_si256((__m256i *)(floorRow + block), floorTexels);
+			_mm256_storeu_si256((__m256i *)(ceilingRow + block), ceilingTexels);
+			continue;
+		}
+
+		uint32_t floorLanes[8];
+		uint32_t ceilingLanes[8];
+		_mm256_storeu_si256((__m256i *)floorLanes, floorTexels);
+		_mm256_storeu_si256((__m256i *)ceilingLanes, ceilingTexels);
+		for (int i = 0; i < 8; i++)
+		{
+			const int end = MIN((block + i + 1) * blockWidth, rowWidth);
+			for (int pixel = (block + i) * blockWidth; pixel < end; pixel++)
+			{
+				floorRow[pixel] = floorLanes[i];
+				ceilingRow[pixel] = ceilingLanes[i];
+			}
+		}
+	}
+	return block;
+}
+
+#endif
+
+// Scales the colour channels of pixels by brightness / 256, a simple loop the compiler vectorizes
+static void ShadeRow(uint32_t *pixels, int count, uint32_t brightness)
+{
+	for (int x = 0; x < count; x++)
+	{
+		const uint32_t pixel = pixels[x];
+		const uint32_t r = ((pixel & 0xFF) * brightness) >> 8;
+		const uint32_t g = (((pixel >> 8) & 0xFF) * brightness) >> 8;
+		const uint32_t b = (((pixel >> 16) & 0xFF) * brightness) >> 8;
+		pixels[x] = r | (g << 8) | (b << 16) | 0xFF000000;
+	}
+}
+
+/*
+ * Casts rows first to first + count - 1 below the horizon of target and their mirror images above
+ * it. A floor row and the ceiling row mirrored across the horizon see the same distance and the
+ * same cells, so both are textured in one pass with one divide per row pair. Across the row the
+ * floor position then only needs adding a constant step, kept in 16.16 fixed point so the cell and
+ * the position inside it come straight out of the bits (which limits maps to 32767 cells a side).
+ * On AVX2 CPUs the texels of 8 blocks are gathered at once. Rows are independent, split them
+ * between jobs freely.
+ */
+void CastFloorRows(SoftwareFramebuffer *target, const FloorView *view, const SurfaceGrid *grid, const SurfaceTextures *surfaces, const SoftwareTexture *atlas, int first, int count)
+{
+	const int horizon = target->height / 2;
+	const int blockWidth = MAX(view->blockWidth, 1);
+	const int blockCount = (target->width + blockWidth - 1) / blockWidth;
+	if (atlas->pixels == NULL) { return; }
+#if defined(FLOOR_CAST_X86)
+	const bool gather = GetRayPacketWidth() == PACKET_AVX2;
+#endif
+
+	for (int k = first; k < first + count && k < horizon; k++)
+	{
+		// Sampled through the middle of the row
+		const float distance = view->rowScale / ((float)k + 0.5f);
+		const uint32_t brightness = (uint32_t)(MIN(view->lightRange / distance, 1.0f) * 256.0f);
+		int32_t x = (int32_t)((view->position.x + (distance * view->rayStart.x)) * 65536.0f);
+		int32_t y = (int32_t)((view->position.y + (distance * view->rayStart.y)) * 65536.0f);
+		const int32_t stepX = (int32_t)(distance * view->rayStep.x * 65536.0f);
+		const int32_t stepY = (int32_t)(distance * view->rayStep.y * 65536.0f);
+
+		uint32_t *floorRow = target->pixels + ((size_t)(horizon + k) * target->width);
+		uint32_t *ceilingRow = target->pixels + ((size_t)(horizon - 1 - k) * target->width);
+		int block = 0;
+#if defined(FLOOR_CAST_X86)
+		if (gather)
+		{
+			block = CastFloorBlocksAVX2(floorRow, ceilingRow, target->width, blockWidth, blockCount, x, y, stepX, stepY, grid, surfaces, atlas);
+			x += stepX * block;
+			y += stepY * block;
+		}
+#endif
+		for (; block < blockCount; block++, x += stepX, y += stepY)
+		{
+			MapCell floor;
+			MapCell ceiling;
+			GetSurfaceCell(grid, x, y, &floor, &ceiling);
+
+			const uint32_t u = (uint32_t)x & 0xFFFF;
+			const uint32_t v = (uint32_t)y & 0xFFFF;
+			const uint32_t floorTexel = FetchSurfaceTexel(atlas, &surfaces->floors[floor], u, v);
+			const uint32_t ceilingTexel = FetchSurfaceTexel(atlas, &surfaces->ceilings[ceiling], u, v);
+			const int end = MIN((block + 1) * blockWidth, target->width);
+			for (int pixel = block * blockWidth; pixel < end; pixel++)
+			{
+				floorRow[pixel] = floorTexel;
+				ceilingRow[pixel] = ceilingTexel;
+			}
+		}
+
+		ShadeRow(floorRow, target->width, brightness);
+		ShadeRow(ceilingRow, target->width, brightness);
+	}
+}
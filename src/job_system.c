@@ -0,0 +1,408 @@
+#include "job_system.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// raylib.h is deliberately not included here, windows.h clashes with several of its names
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOGDI
+	#define NOUSER
+	#include <windows.h>
+	typedef HANDLE JobThread;
+	typedef SRWLOCK JobLock;
+	typedef CONDITION_VARIABLE JobCondition;
+	#define THREAD_LOCAL __declspec(thread)
+#else
+	#include <pthread.h>
+	#include <sched.h>
+	#include <unistd.h>
+	typedef pthread_t JobThread;
+	typedef pthread_mutex_t JobLock;
+	typedef pthread_cond_t JobCondition;
+	#define THREAD_LOCAL __thread
+#endif
+
+#define MAX_JOB_THREADS 64
+#define JOB_DEQUE_CAPACITY 256	// Must be a power of 2
+#define BACKGROUND_QUEUE_CAPACITY 256	// Must be a power of 2
+
+typedef struct Job {
+	JobFunction function;
+	void *data;
+	int first;
+	int count;
+	JobCounter *group;
+} Job;
+
+// Per-thread double ended queue. The owning thread pushes and pops at the bottom (newest first),
+// idle threads steal from the top (oldest first) so they take the work furthest from the owner.
+typedef struct JobDeque {
+	JobLock lock;
+	int top;
+	int bottom;
+	Job jobs[JOB_DEQUE_CAPACITY];
+} JobDeque;
+
+static JobDeque *deques;	// Index 0 belongs to the main thread, 1..N to the workers
+static JobThread workers[MAX_JOB_THREADS];
+static unsigned int threadCount = 1;
+static volatile long queuedJobs;
+static volatile long running;
+static JobLock wakeLock;
+static JobCondition wakeCondition;
+static THREAD_LOCAL int threadIndex;
+
+// Background jobs get a thread of their own and a plain FIFO queue. They may block (e.g. on disk
+// reads) so they are kept away from the deques the frame's RunParallelFor() calls help out with.
+static JobThread backgroundWorker;
+static JobLock backgroundLock;
+static JobCondition backgroundCondition;
+static Job backgroundJobs[BACKGROUND_QUEUE_CAPACITY];
+static int backgroundTop;
+static int backgroundBottom;
+
+/*
+ * Thin wrappers over the platform threading primitives.
+ */
+#if defined(_WIN32)
+static void InitJobLock(JobLock *lock) { InitializeSRWLock(lock); }
+static void DestroyJobLock(JobLock *lock) { (void)lock; }
+static void LockJobLock(JobLock *lock) { AcquireSRWLockExclusive(lock); }
+static void UnlockJobLock(JobLock *lock) { ReleaseSRWLockExclusive(lock); }
+static void InitJobCondition(JobCondition *condition) { InitializeConditionVariable(condition); }
+static void DestroyJobCondition(JobCondition *condition) { (void)condition; }
+static void WaitJobCondition(JobCondition *condition, JobLock *lock) { SleepConditionVariableSRW(condition, lock, INFINITE, 0); }
+static void WakeAllJobCondition(JobCondition *condition) { WakeAllConditionVariable(condition); }
+static long AtomicAdd(volatile long *value, long amount) { return InterlockedExchangeAdd(value, amount) + amount; }
+static long AtomicLoad(volatile long *value) { return InterlockedCompareExchange(value, 0, 0); }
+static void YieldJobThread() { SwitchToThread(); }
+static unsigned int GetCoreCount()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+}
+#else
+static void InitJobLock(JobLock *lock) { pthread_mutex_init(lock, NULL); }
+static void DestroyJobLock(JobLock *lock) { pthread_mutex_destroy(lock); }
+static void LockJobLock(JobLock *lock) { pthread_mutex_lock(lock); }
+static void UnlockJobLock(JobLock *lock) { pthread_mutex_unlock(lock); }
+static void InitJobCondition(JobCondition *condition) { pthread_cond_init(condition, NULL); }
+static void DestroyJobCondition(JobCondition *condition) { pthread_cond_destroy(condition); }
+static void WaitJobCondition(JobCondition *condition, JobLock *lock) { pthread_cond_wait(condition, lock); }
+static void WakeAllJobCondition(JobCondition *condition) { pthread_cond_broadcast(condition); }
+static long AtomicAdd(volatile long *value, long amount) { return __atomic_add_fetch(value, amount, __ATOMIC_SEQ_CST); }
+static long AtomicLoad(volatile long *value) { return __atomic_load_n(value, __ATOMIC_SEQ_CST); }
+static void YieldJobThread() { sched_yield(); }
+static unsigned int GetCoreCount()
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores > 0 ? (unsigned int)cores : 1;
+}
+#endif
+
+static bool PushJob(JobDeque *deque, Job job)
+{
+	bool pushed = false;
+	LockJobLock(&deque->lock);
+	if (deque->bottom - deque->top < JOB_DEQUE_CAPACITY)
+	{
+		deque->jobs[deque->bottom & (JOB_DEQUE_CAPACITY - 1)] = job;
+		deque->bottom++;
+		pushed = true;
+	}
+	UnlockJobLock(&deque->lock);
+	return pushed;
+}
+
+static bool PopJob(JobDeque *deque, Job *job)
+{
+	bool popped = false;
+	LockJobLock(&deque->lock);
+	if (deque->bottom != deque->top)
+	{
+		deque->bottom--;
+		*job = deque->jobs[deque->bottom & (JOB_DEQUE_CAPACITY - 1)];
+		popped = true;
+	}
+	UnlockJobLock(&deque->lock);
+	return popped;
+}
+
+static bool StealJob(JobDeque *deque, Job *job)
+{
+	bool stolen = false;
+	LockJobLock(&deque->lock);
+	if (deque->bottom != deque->top)
+	{
+		*job = deque->jobs[deque->top & (JOB_DEQUE_CAPACITY - 1)];
+		deque->top++;
+		stolen = true;
+	}
+	UnlockJobLock(&deque->lock);
+	return stolen;
+}
+
+/*
+ * Takes the newest job from this thread's own deque, or steals the oldest job from the next
+ * thread that has one.
+ */
+static bool TakeJob(int index, Job *job)
+{
+	bool found = PopJob(&deques[index], job);
+	for (unsigned int i = 1; !found && i < threadCount; i++)
+	{
+		found = StealJob(&deques[(index + i) % threadCount], job);
+	}
+	if (found) { AtomicAdd(&queuedJobs, -1); }
+	return found;
+}
+
+static void RunJob(const Job *job)
+{
+	job->function(job->data, job->first, job->count);
+	AtomicAdd(&job->group->pending, -1);
+}
+
+static void WorkerLoop(int index)
+{
+	threadIndex = index;
+	while (AtomicLoad(&running))
+	{
+		Job job;
+		if (TakeJob(index, &job))
+		{
+			RunJob(&job);
+			continue;
+		}
+
+		// Nothing to run or steal, sleep until more jobs are queued
+		LockJobLock(&wakeLock);
+		while (AtomicLoad(&running) && AtomicLoad(&queuedJobs) == 0)
+		{
+			WaitJobCondition(&wakeCondition, &wakeLock);
+		}
+		UnlockJobLock(&wakeLock);
+	}
+}
+
+static void BackgroundLoop()
+{
+	LockJobLock(&backgroundLock);
+	while (true)
+	{
+		while (AtomicLoad(&running) && backgroundTop == backgroundBottom)
+		{
+			WaitJobCondition(&backgroundCondition, &backgroundLock);
+		}
+		// Whatever is still queued at shutdown is finished first, callers may be waiting on it
+		if (backgroundTop == backgroundBottom) { break; }
+
+		Job job = backgroundJobs[backgroundTop & (BACKGROUND_QUEUE_CAPACITY - 1)];
+		backgroundTop++;
+		UnlockJobLock(&backgroundLock);
+		RunJob(&job);
+		LockJobLock(&backgroundLock);
+	}
+	UnlockJobLock(&backgroundLock);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI WorkerMain(LPVOID param)
+{
+	WorkerLoop((int)(INT_PTR)param);
+	return 0;
+}
+
+static DWORD WINAPI BackgroundMain(LPVOID param)
+{
+	BackgroundLoop();
+	return 0;
+}
+#else
+static void *WorkerMain(void *param)
+{
+	WorkerLoop((int)(intptr_t)param);
+	return NULL;
+}
+
+static void *BackgroundMain(void *param)
+{
+	BackgroundLoop();
+	return NULL;
+}
+#endif
+
+/*
+ * Starts the worker threads. A workerCount of 0 uses one worker per core besides the main thread.
+ * Without a job system (or with no workers) RunParallelFor() simply runs on the calling thread.
+ */
+void CreateJobSystem(unsigned int workerCount)
+{
+	if (workerCount == 0) { workerCount = GetCoreCount() - 1; }
+	if (workerCount > MAX_JOB_THREADS - 1) { workerCount = MAX_JOB_THREADS - 1; }
+	if (workerCount == 0 || deques != NULL) { return; }
+
+	threadCount = workerCount + 1;
+	deques = calloc(threadCount, sizeof(JobDeque));
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		InitJobLock(&deques[i].lock);
+	}
+	InitJobLock(&wakeLock);
+	InitJobCondition(&wakeCondition);
+	InitJobLock(&backgroundLock);
+	InitJobCondition(&backgroundCondition);
+	queuedJobs = 0;
+	backgroundTop = 0;
+	backgroundBottom = 0;
+	running = 1;
+
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+#if defined(_WIN32)
+		workers[i] = CreateThread(NULL, 0, WorkerMain, (LPVOID)(INT_PTR)i, 0, NULL);
+#else
+		pthread_create(&workers[i], NULL, WorkerMain, (void *)(intptr_t)i);
+#endif
+	}
+#if defined(_WIN32)
+	backgroundWorker = CreateThread(NULL, 0, BackgroundMain, NULL, 0, NULL);
+#else
+	pthread_create(&backgroundWorker, NULL, BackgroundMain, NULL);
+#endif
+}
+
+void DestroyJobSystem()
+{
+	if (deques == NULL) { return; }
+
+	AtomicAdd(&running, -1);
+	LockJobLock(&wakeLock);
+	WakeAllJobCondition(&wakeCondition);
+	UnlockJobLock(&wakeLock);
+	LockJobLock(&backgroundLock);
+	WakeAllJobCondition(&backgroundCondition);
+	UnlockJobLock(&backgroundLock);
+
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+#if defined(_WIN32)
+		WaitForSingleObject(workers[i], INFINITE);
+		CloseHandle(workers[i]);
+#else
+		pthread_join(workers[i], NULL);
+#endif
+	}
+#if defined(_WIN32)
+	WaitForSingleObject(backgroundWorker, INFINITE);
+	CloseHandle(backgroundWorker);
+#else
+	pthread_join(backgroundWorker, NULL);
+#endif
+
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		DestroyJobLock(&deques[i].lock);
+	}
+	DestroyJobLock(&wakeLock);
+	DestroyJobCondition(&wakeCondition);
+	DestroyJobLock(&backgroundLock);
+	DestroyJobCondition(&backgroundCondition);
+	free(deques);
+	deques = NULL;
+	threadCount = 1;
+}
+
+unsigned int GetJobWorkerCount() { return threadCount - 1; }
+
+/*
+ * Splits [0, itemCount) into chunks of chunkSize items and runs function on every chunk across
+ * all threads. The chunks are queued on the calling thread's deque for the workers to steal, the
+ * caller keeps running chunks itself and only returns once all of them are finished. Safe to call
+ * from inside a job.
+ */
+void RunParallelFor(JobFunction function, void *data, int itemCount, int chunkSize)
+{
+	if (itemCount <= 0) { return; }
+	if (chunkSize < 1) { chunkSize = 1; }
+	if (deques == NULL || itemCount <= chunkSize)
+	{
+		function(data, 0, itemCount);
+		return;
+	}
+
+	JobCounter group = { (itemCount + chunkSize - 1) / chunkSize };
+	for (int first = 0; first < itemCount; first += chunkSize)
+	{
+		Job job = { function, data, first, itemCount - first < chunkSize ? itemCount - first : chunkSize, &group };
+		if (PushJob(&deques[threadIndex], job))
+		{
+			AtomicAdd(&queuedJobs, 1);
+		}
+		else
+		{
+			// Deque is full, just do it here
+			RunJob(&job);
+		}
+	}
+
+	LockJobLock(&wakeLock);
+	WakeAllJobCondition(&wakeCondition);
+	UnlockJobLock(&wakeLock);
+
+	// Help out until every chunk from this call is done
+	while (AtomicLoad(&group.pending) > 0)
+	{
+		Job job;
+		if (TakeJob(threadIndex, &job))
+		{
+			RunJob(&job);
+		}
+		else
+		{
+			YieldJobThread();
+		}
+	}
+}
+
+/*
+ * Queues function on the background thread and returns straight away, counter is counted up now
+ * and back down once the job is done. Meant for slow work like disk reads that must never hold up
+ * a frame. Without a job system (or with the queue full) the job runs right here instead.
+ */
+void RunBackgroundJob(JobFunction function, void *data, int first, int count, JobCounter *counter)
+{
+	Job job = { function, data, first, count, counter };
+	AtomicAdd(&counter->pending, 1);
+
+	bool queued = false;
+	if (deques != NULL)
+	{
+		LockJobLock(&backgroundLock);
+		if (backgroundBottom - backgroundTop < BACKGROUND_QUEUE_CAPACITY)
+		{
+			backgroundJobs[backgroundBottom & (BACKGROUND_QUEUE_CAPACITY - 1)] = job;
+			backgroundBottom++;
+			queued = true;
+			WakeAllJobCondition(&backgroundCondition);
+		}
+		UnlockJobLock(&backgroundLock);
+	}
+	if (!queued) { RunJob(&job); }
+}
+
+bool IsJobCounterDone(JobCounter *counter)
+{
+	return AtomicLoad(&counter->pending) == 0;
+}
+
+// Blocks until every job counted by counter is done
+void WaitJobCounter(JobCounter *counter)
+{
+	while (!IsJobCounterDone(counter))
+	{
+		YieldJobThread();
+	}
+}
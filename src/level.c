@@ -0,0 +1,405 @@
+#include "level.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// raylib.h is deliberately not included here, windows.h clashes with several of its names
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOGDI
+	#define NOUSER
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#define LEVEL_MAX_CHUNK_SIZE 1024
+
+/*
+ * Maps the whole file read only. Returns NULL if it can't be opened or is empty.
+ */
+#if defined(_WIN32)
+static const uint8_t *MapWholeFile(const char *fileName, size_t *size, void **handle)
+{
+	HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) { return NULL; }
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = NULL;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+	{
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	// The mapping keeps the file open
+	CloseHandle(file);
+	if (mapping == NULL) { return NULL; }
+
+	const uint8_t *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL)
+	{
+		CloseHandle(mapping);
+		return NULL;
+	}
+	*size = (size_t)fileSize.QuadPart;
+	*handle = mapping;
+	return data;
+}
+
+static void UnmapWholeFile(const uint8_t *data, size_t size, void *handle)
+{
+	UnmapViewOfFile(data);
+	CloseHandle(handle);
+}
+#else
+static const uint8_t *MapWholeFile(const char *fileName, size_t *size, void **handle)
+{
+	int file = open(fileName, O_RDONLY);
+	if (file < 0) { return NULL; }
+
+	struct stat info;
+	void *data = MAP_FAILED;
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	}
+	// The mapping keeps the file open
+	close(file);
+	if (data == MAP_FAILED) { return NULL; }
+
+	*size = (size_t)info.st_size;
+	*handle = NULL;
+	return data;
+}
+
+static void UnmapWholeFile(const uint8_t *data, size_t size, void *handle)
+{
+	munmap((void *)data, size);
+}
+#endif
+
+// Level files are little endian. The index is read straight from the mapping, so only little
+// endian hosts can open them, writing swaps the fields on the others.
+static bool IsHostLittleEndian()
+{
+	const uint16_t probe = 1;
+	uint8_t first;
+	memcpy(&first, &probe, sizeof(first));
+	return first == 1;
+}
+
+static uint32_t SwapBytes32(uint32_t value)
+{
+	return (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+}
+
+static uint64_t SwapBytes64(uint64_t value)
+{
+	return ((uint64_t)SwapBytes32((uint32_t)value) << 32) | SwapBytes32((uint32_t)(value >> 32));
+}
+
+/*
+ * Checks the header and that the index and every stored chunk lie inside the file, so nothing read
+ * later through the LevelFile can run off the end of the mapping.
+ */
+static bool IsLevelFileValid(const uint8_t *data, size_t size)
+{
+	if (size < sizeof(LevelFileHeader)) { return false; }
+
+	LevelFileHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, LEVEL_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != LEVEL_FILE_VERSION) { return false; }
+	if (header.width == 0 || header.height == 0 || header.width > INT32_MAX || header.height > INT32_MAX) { return false; }
+	if (header.chunkSize == 0 || header.chunkSize > LEVEL_MAX_CHUNK_SIZE) { return false; }
+	if (header.chunkCols != (header.width + header.chunkSize - 1) / header.chunkSize ||
+		header.chunkRows != (header.height + header.chunkSize - 1) / header.chunkSize) { return false; }
+
+	const uint64_t chunkCount = (uint64_t)header.chunkCols * header.chunkRows;
+	const uint64_t chunkBytes = (uint64_t)header.chunkSize * header.chunkSize;
+	if (header.indexOffset % sizeof(uint64_t) != 0 || header.indexOffset + (chunkCount * sizeof(LevelChunkInfo)) > size) { return false; }
+
+	const LevelChunkInfo *chunks = (const LevelChunkInfo *)(data + header.indexOffset);
+	for (uint64_t i = 0; i < chunkCount; i++)
+	{
+		if (chunks[i].offset != 0 && (chunks[i].offset > size || chunkBytes > size - chunks[i].offset)) { return false; }
+	}
+	return true;
+}
+
+/*
+ * Maps a level file and checks it. Returns a level with no data if the file can't be read or isn't
+ * a valid level, check it with IsLevelFileReady().
+ */
+LevelFile OpenLevelFile(const char *fileName)
+{
+	LevelFile level = { 0 };
+	size_t size = 0;
+	void *handle = NULL;
+	if (!IsHostLittleEndian()) { return level; }
+
+	const uint8_t *data = MapWholeFile(fileName, &size, &handle);
+	if (data == NULL) { return level; }
+
+	if (!IsLevelFileValid(data, size))
+	{
+		UnmapWholeFile(data, size, handle);
+		return level;
+	}
+
+	LevelFileHeader header;
+	memcpy(&header, data, sizeof(header));
+	level.width = (int)header.width;
+	level.height = (int)header.height;
+	level.chunkSize = (int)header.chunkSize;
+	level.chunkCols = (int)header.chunkCols;
+	level.chunkRows = (int)header.chunkRows;
+	level.chunks = (const LevelChunkInfo *)(data + header.indexOffset);
+	level.data = data;
+	level.size = size;
+	level.handle = handle;
+	return level;
+}
+
+void CloseLevelFile(LevelFile level)
+{
+	if (level.data != NULL) { UnmapWholeFile(level.data, level.size, level.handle); }
+}
+
+bool IsLevelFileReady(LevelFile level)
+{
+	return level.data != NULL;
+}
+
+// Index entry of a chunk, NULL outside the level
+const LevelChunkInfo *GetLevelChunkInfo(const LevelFile *level, int chunkCol, int chunkRow)
+{
+	if (chunkCol < 0 || chunkRow < 0 || chunkCol >= level->chunkCols || chunkRow >= level->chunkRows) { return NULL; }
+	return &level->chunks[(long)chunkRow * level->chunkCols + chunkCol];
+}
+
+/*
+ * Copies a chunk's cells into the same cells of map, clipped to the map. Returns the number of
+ * cells written along each side in *width and *height.
+ */
+static void CopyLevelChunk(const LevelFile *level, int chunkCol, int chunkRow, Map *map, int *width, int *height)
+{
+	*width = 0;
+	*height = 0;
+	const LevelChunkInfo *info = GetLevelChunkInfo(level, chunkCol, chunkRow);
+	const int col = chunkCol * level->chunkSize;
+	const int row = chunkRow * level->chunkSize;
+	if (info == NULL || col >= map->width || row >= map->height) { return; }
+
+	*width = (col + level->chunkSize < map->width ? level->chunkSize : map->width - col);
+	*height = (row + level->chunkSize < map->height ? level->chunkSize : map->height - row);
+	MapCell fill[LEVEL_MAX_CHUNK_SIZE];
+	memset(fill, info->fill, sizeof(fill));
+	for (int y = 0; y < *height; y++)
+	{
+		const MapCell *cells = info->offset == 0 ? fill : level->data + info->offset + ((size_t)y * level->chunkSize);
+		WriteMapCells(map, col, row + y, cells, *width);
+	}
+}
+
+/*
+ * Loads one chunk of the level into map, e.g. to stream in only the part of a large level around
+ * the player. The cells are marked dirty for the map's listeners.
+ */
+void ReadLevelChunk(const LevelFile *level, int chunkCol, int chunkRow, Map *map)
+{
+	int width, height;
+	CopyLevelChunk(level, chunkCol, chunkRow, map, &width, &height);
+	MarkMapRegionDirty(map, chunkCol * level->chunkSize, chunkRow * level->chunkSize, width, height);
+}
+
+/*
+ * Copies all chunkSize * chunkSize cells of a chunk, padding included, into cells. Only reads the
+ * mapping so it is safe to call from any thread.
+ */
+void ReadLevelChunkCells(const LevelFile *level, int chunkCol, int chunkRow, MapCell *cells)
+{
+	const LevelChunkInfo *info = GetLevelChunkInfo(level, chunkCol, chunkRow);
+	if (info == NULL) { return; }
+
+	const size_t chunkBytes = (size_t)level->chunkSize * level->chunkSize * sizeof(MapCell);
+	if (info->offset == 0)
+	{
+		memset(cells, info->fill, chunkBytes);
+	}
+	else
+	{
+		memcpy(cells, level->data + info->offset, chunkBytes);
+	}
+}
+
+/*
+ * Tells the OS the chunk's pages won't be needed for a while so they can be dropped from memory.
+ * They are read back in from the file if the chunk is read again.
+ */
+void ReleaseLevelChunk(const LevelFile *level, int chunkCol, int chunkRow)
+{
+	const LevelChunkInfo *info = GetLevelChunkInfo(level, chunkCol, chunkRow);
+	if (info == NULL || info->offset == 0 || info->offset % LEVEL_CHUNK_ALIGN != 0) { return; }
+
+	const size_t chunkBytes = (size_t)level->chunkSize * level->chunkSize * sizeof(MapCell);
+#if defined(_WIN32)
+	// Unmodified file backed pages are trimmed by the OS on its own
+	(void)chunkBytes;
+#else
+	madvise((void *)(level->data + info->offset), chunkBytes, MADV_DONTNEED);
+#endif
+}
+
+/*
+ * Builds a map with every chunk of the level read in.
+ */
+Map LoadMapFromLevel(const LevelFile *level)
+{
+	Map map = LoadMapEmpty(level->width, level->height);
+	if (!IsMapReady(map)) { return map; }
+
+	for (int chunkRow = 0; chunkRow < level->chunkRows; chunkRow++)
+	{
+		for (int chunkCol = 0; chunkCol < level->chunkCols; chunkCol++)
+		{
+			int width, height;
+			CopyLevelChunk(level, chunkCol, chunkRow, &map, &width, &height);
+		}
+	}
+	return map;
+}
+
+/*
+ * Opens, loads and closes a level file in one go. Returns a map with no cells on failure, check it
+ * with IsMapReady().
+ */
+Map LoadMapFromLevelFile(const char *fileName)
+{
+	LevelFile level = OpenLevelFile(fileName);
+	if (!IsLevelFileReady(level)) { return (Map){ 0 }; }
+
+	Map map = LoadMapFromLevel(&level);
+	CloseLevelFile(level);
+	return map;
+}
+
+// Cell of the chunk at x, y, padding outside the map reads as a wall
+static MapCell GetChunkCell(const Map *map, int chunkCol, int chunkRow, int x, int y)
+{
+	return GetMapCell(map, (chunkCol * LEVEL_CHUNK_SIZE) + x, (chunkRow * LEVEL_CHUNK_SIZE) + y);
+}
+
+/*
+ * Fills in a chunk's index entry, leaving offset at 0 if every cell inside the map is the same.
+ */
+static LevelChunkInfo DescribeChunk(const Map *map, int chunkCol, int chunkRow)
+{
+	LevelChunkInfo info = { 0 };
+	info.fill = GetChunkCell(map, chunkCol, chunkRow, 0, 0);
+
+	bool uniform = true;
+	for (int y = 0; y < LEVEL_CHUNK_SIZE; y++)
+	{
+		for (int x = 0; x < LEVEL_CHUNK_SIZE; x++)
+		{
+			const int col = (chunkCol * LEVEL_CHUNK_SIZE) + x;
+			const int row = (chunkRow * LEVEL_CHUNK_SIZE) + y;
+			if (!IsMapCellInside(map, col, row)) { continue; }
+
+			const MapCell cell = GetMapCell(map, col, row);
+			info.wallCount += cell != CELL_EMPTY;
+			uniform = uniform && cell == info.fill;
+		}
+	}
+	info.offset = uniform ? 0 : 1;	// Real offset assigned by the caller
+	return info;
+}
+
+/*
+ * Writes map as a level file with LEVEL_CHUNK_SIZE chunks. Returns false if the file couldn't be
+ * written.
+ */
+bool ExportLevelFile(const Map *map, const char *fileName)
+{
+	if (!IsMapReady(*map)) { return false; }
+
+	LevelFileHeader header = { 0 };
+	memcpy(header.magic, LEVEL_FILE_MAGIC, sizeof(header.magic));
+	header.version = LEVEL_FILE_VERSION;
+	header.width = (uint32_t)map->width;
+	header.height = (uint32_t)map->height;
+	header.chunkSize = LEVEL_CHUNK_SIZE;
+	header.chunkCols = (header.width + LEVEL_CHUNK_SIZE - 1) / LEVEL_CHUNK_SIZE;
+	header.chunkRows = (header.height + LEVEL_CHUNK_SIZE - 1) / LEVEL_CHUNK_SIZE;
+	header.indexOffset = sizeof(LevelFileHeader);
+
+	const size_t chunkCount = (size_t)header.chunkCols * header.chunkRows;
+	LevelChunkInfo *chunks = calloc(chunkCount, sizeof(LevelChunkInfo));
+	FILE *file = fopen(fileName, "wb");
+	if (chunks == NULL || file == NULL)
+	{
+		free(chunks);
+		if (file != NULL) { fclose(file); }
+		return false;
+	}
+
+	// Stored chunks follow the index back to back, starting on a page boundary
+	const uint64_t indexEnd = header.indexOffset + (chunkCount * sizeof(LevelChunkInfo));
+	const uint64_t dataOffset = (indexEnd + LEVEL_CHUNK_ALIGN - 1) / LEVEL_CHUNK_ALIGN * LEVEL_CHUNK_ALIGN;
+	uint64_t nextOffset = dataOffset;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		chunks[i] = DescribeChunk(map, (int)(i % header.chunkCols), (int)(i / header.chunkCols));
+		if (chunks[i].offset != 0)
+		{
+			chunks[i].offset = nextOffset;
+			nextOffset += LEVEL_CHUNK_SIZE * LEVEL_CHUNK_SIZE * sizeof(MapCell);
+		}
+	}
+
+	LevelFileHeader stored = header;
+	if (!IsHostLittleEndian())
+	{
+		stored.version = SwapBytes32(stored.version);
+		stored.width = SwapBytes32(stored.width);
+		stored.height = SwapBytes32(stored.height);
+		stored.chunkSize = SwapBytes32(stored.chunkSize);
+		stored.chunkCols = SwapBytes32(stored.chunkCols);
+		stored.chunkRows = SwapBytes32(stored.chunkRows);
+		stored.indexOffset = SwapBytes32(stored.indexOffset);
+		// Offsets are only compared against 0 from here on, which swapping keeps
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			chunks[i].offset = SwapBytes64(chunks[i].offset);
+			chunks[i].wallCount = SwapBytes32(chunks[i].wallCount);
+		}
+	}
+
+	bool written = fwrite(&stored, sizeof(stored), 1, file) == 1;
+	written = written && fwrite(chunks, sizeof(LevelChunkInfo), chunkCount, file) == chunkCount;
+	for (uint64_t i = indexEnd; written && i < dataOffset; i++)
+	{
+		written = fputc(0, file) != EOF;
+	}
+
+	MapCell cells[LEVEL_CHUNK_SIZE * LEVEL_CHUNK_SIZE];
+	for (size_t i = 0; written && i < chunkCount; i++)
+	{
+		if (chunks[i].offset == 0) { continue; }
+
+		for (int y = 0; y < LEVEL_CHUNK_SIZE; y++)
+		{
+			for (int x = 0; x < LEVEL_CHUNK_SIZE; x++)
+			{
+				cells[(y * LEVEL_CHUNK_SIZE) + x] = GetChunkCell(map, (int)(i % header.chunkCols), (int)(i / header.chunkCols), x, y);
+			}
+		}
+		written = fwrite(cells, sizeof(cells), 1, file) == 1;
+	}
+
+	free(chunks);
+	return fclose(file) == 0 && written;
+}
@@ -0,0 +1,93 @@
+#include "line_of_sight.h"
+#include "job_system.h"
+#include "helpful_math.h"
+
+#include <math.h>
+#include <stddef.h>
+
+// Queries per job, a multiple of SIGHT_WORD_BITS so no two jobs write the same word of visible[]
+#define SIGHT_CHUNK_SIZE 1024
+
+typedef struct SightJob {
+	const OccupancyGrid *grid;
+	const SightQuery *queries;
+	uint64_t *visible;
+	float *distances;
+} SightJob;
+
+/*
+ * True if no wall stands between from and to. Steps cell by cell over the occupancy bitmap like
+ * the renderer's scalar DDA, but picks each step with selects instead of a branch: sightlines point
+ * every which way so the branch would mispredict about every other cell. distance is optional and
+ * gets how far from from the first wall in the way is, or the length of the segment if there is
+ * none. The cell from is in is never tested, a target inside a wall is hidden by it.
+ */
+bool CheckLineOfSight(const OccupancyGrid *grid, Vector2 from, Vector2 to, float *distance)
+{
+	const Vector2 delta = Vector2Subtract(to, from);
+	const float length = Vector2Length(delta);
+	// Lines the segment runs parallel to are never reached, same as an infinitely long step
+	const Vector2 step = (Vector2){
+		delta.x != 0.0f ? fabsf(length / delta.x) : INFINITY,
+		delta.y != 0.0f ? fabsf(length / delta.y) : INFINITY
+	};
+	const int dirX = delta.x < 0 ? -1 : 1;
+	const int dirY = delta.y < 0 ? -1 : 1;
+
+	// Convert pixel coords into map grid coords
+	int mapCol = (int)floorf(from.x);
+	int mapRow = (int)floorf(from.y);
+	// Length along the segment to the next vertical and horizontal grid line
+	float rayLengthX = (dirX > 0 ? (float)(mapCol + 1) - from.x : from.x - (float)mapCol) * step.x;
+	float rayLengthY = (dirY > 0 ? (float)(mapRow + 1) - from.y : from.y - (float)mapRow) * step.y;
+
+	float distanceChecked = 0.0f;
+	bool hitWall = false;
+	while (!hitWall && distanceChecked < length)
+	{
+		// Step along shortest length
+		const bool stepX = rayLengthX < rayLengthY;
+		distanceChecked = stepX ? rayLengthX : rayLengthY;
+		mapCol += stepX ? dirX : 0;
+		mapRow += stepX ? 0 : dirY;
+		rayLengthX += stepX ? step.x : 0.0f;
+		rayLengthY += stepX ? 0.0f : step.y;
+
+		hitWall = IsCellOccupied(grid, mapCol, mapRow);
+	}
+
+	if (distance != NULL) { *distance = MIN(distanceChecked, length); }
+	return !hitWall || distanceChecked >= length;
+}
+
+static void CheckSightChunk(void *data, int first, int count)
+{
+	const SightJob *job = data;
+	// Chunks start on a word, so each word is built up here and stored once
+	for (int word = first; word < first + count; word += SIGHT_WORD_BITS)
+	{
+		const int last = MIN(word + SIGHT_WORD_BITS, first + count);
+		uint64_t bits = 0;
+		for (int i = word; i < last; i++)
+		{
+			float distance;
+			const bool visible = CheckLineOfSight(job->grid, job->queries[i].from, job->queries[i].to, &distance);
+			bits |= (uint64_t)visible << (i - word);
+			if (job->distances != NULL) { job->distances[i] = distance; }
+		}
+		job->visible[word / SIGHT_WORD_BITS] = bits;
+	}
+}
+
+/*
+ * Answers count line of sight queries at once, split across the job system's threads. visible
+ * needs GetSightWordCount(count) words and gets a bit per query, see IsSightVisible(). distances is
+ * optional and gets the same distance CheckLineOfSight() would for each query. Nothing is drawn and
+ * nothing but the outputs is written, so it is safe to call from anywhere the grid isn't being
+ * changed.
+ */
+void CheckLinesOfSight(const OccupancyGrid *grid, const SightQuery queries[], int count, uint64_t visible[], float distances[])
+{
+	SightJob job = { grid, queries, visible, distances };
+	RunParallelFor(CheckSightChunk, &job, count, SIGHT_CHUNK_SIZE);
+}
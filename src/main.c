@@ -29,33 +29,82 @@ For a C++ project simply rename the file to .cpp and re-run the build script
 #include "raymath.h"
 #include "renderer.h"
 #include "player.h"
+#include "map.h"
+#include "job_system.h"
+#include "world_stream.h"
+#include "actor.h"
 
 #include "resource_dir.h"			// utility header for SearchAndSetResourceDir
 #include <stdio.h>                  // Required for: fopen(), fclose(), fputc(), fwrite(), printf(), fprintf(), funopen()
 #include <time.h>                   // Required for: time_t, tm, time(), localtime(), strftime()
 #include <math.h>					// Need Math extensions
 
-#define MAP_LENGTH 10
-
-const unsigned int map[MAP_LENGTH][MAP_LENGTH] = {
-	{ 1,1,1,1,1,1,1,1,1,1 },
-	{ 1,0,0,0,0,0,0,0,0,1 },
-	{ 1,0,0,0,0,1,0,0,1,1 },
-	{ 1,0,0,0,0,0,0,0,0,1 },
-	{ 1,1,1,0,0,0,0,0,0,1 },
-	{ 1,0,0,0,0,0,0,0,0,1 },
-	{ 1,0,1,0,0,1,1,1,0,1 },
-	{ 1,0,1,0,0,1,1,1,0,1 },
-	{ 1,0,0,0,0,0,0,0,0,1 },
-	{ 1,1,1,1,1,1,1,1,1,1, },
+#define START_LEVEL "levels/start.lvl"
+#define STREAM_CHUNK_RADIUS 2			// Chunks kept loaded around the camera in each direction
+#define STREAM_MEMORY_BUDGET (64 * sizeof(MapPage))	// Bytes of map pages kept loaded
+#define SPRITE_TEXTURE "wabbit_alpha.png"
+#define MAX_ACTORS 1024
+#define NPC_SPEED 1.0f
+
+// A few sprites standing around the start level, the texture is looked up once the renderer is up
+static Sprite sprites[] = {
+	{ { 3.5f, 2.5f }, 0.5f, 0 },
+	{ { 7.5f, 4.5f }, 0.5f, 0 },
+	{ { 1.5f, 7.5f }, 0.75f, 0 },
+	{ { 4.5f, 8.5f }, 0.5f, 0 }
 };
+#define SPRITE_COUNT (int)(sizeof(sprites) / sizeof(sprites[0]))
+
+// Every sprite is an NPC walking back and forth
+static ActorStore actors;
+static ActorHandle spriteActors[SPRITE_COUNT];
+
+/*
+ * Turns NPCs that walked into a wall around and moves their sprites along with them.
+ */
+static void UpdateNPCSprites()
+{
+	for (int i = 0; i < SPRITE_COUNT; i++)
+	{
+		const int slot = GetActorSlot(&actors, spriteActors[i]);
+		if (slot < 0) { continue; }
+		if (actors.flags[slot] & ACTOR_BLOCKED) { SetActorRotation(&actors, slot, actors.rotation[slot] + 180.0f); }
+		sprites[i].position = (Vector2){ actors.positionX[slot], actors.positionY[slot] };
+		UpdateRendererSprite(i);
+	}
+}
 
 int main ()
 {
 	SetTraceLogLevel(LOG_ALL);
 
+	CreateJobSystem(0);
+
+	// Levels live in the resources folder, see tools/level_convert.c for making them
+	SearchAndSetResourceDir("resources");
+	if (!CreateWorldStream(START_LEVEL, STREAM_CHUNK_RADIUS, STREAM_MEMORY_BUDGET))
+	{
+		TraceLog(LOG_ERROR, "Could not load %s", START_LEVEL);
+		DestroyJobSystem();
+		return 1;
+	}
+
+	const Vector2 start = { 1.5, 1.5 };
+	FillWorldStream(start);
+	Map *map = GetWorldStreamMap();
+
+	// Nothing past the loaded chunks is anything but wall, the renderer only copies that far
+	UpdateRendererMapWindow(STREAM_CHUNK_RADIUS * MAP_PAGE_SIZE);
 	CreateRenderer(0, 1, 1280, 960, 90, map);
-	CreatePlayer((Vector2) { 1.5, 1.5 }, 0.0, 2.0, 90.0, 0.2, map);
+	CreatePlayer(start, 0.0, 2.0, 90.0, 0.2, map);
+	UpdatePlayerDistanceField(GetRendererDistanceField());
+	actors = LoadActorStore(MAX_ACTORS);
+	for (int i = 0; i < SPRITE_COUNT; i++)
+	{
+		sprites[i].texture = GetRendererTextureIndex(SPRITE_TEXTURE);
+		spriteActors[i] = SpawnActor(&actors, ACTOR_NPC, sprites[i].position, 90.0f * i, NPC_SPEED, sprites[i].size / 2.0f);
+	}
+	UpdateRendererSprites(sprites, SPRITE_COUNT);
 	
 	
 	// game loop
@@ -63,6 +112,9 @@ int main ()
 	{
 		PlayerInput();
 		RendererInput();
+		UpdateWorldStream(player.position, player.forward);
+		UpdateActors(&actors, map, GetRendererDistanceField(), GetFrameTime());
+		UpdateNPCSprites();
 
 		UpdateRenderCamera(player.position, player.rotation);
 
@@ -71,6 +123,9 @@ int main ()
 	}
 
 	UnloadTextures();
+	UnloadActorStore(actors);
+	DestroyWorldStream();
+	DestroyJobSystem();
 
 	// destory the window and cleanup the OpenGL context
 	CloseWindow();
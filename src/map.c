@@ -0,0 +1,336 @@
+#include "map.h"
+#include "helpful_math.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Stands in for every page a map doesn't store, never written after it is filled
+static MapPage solidPage;
+static bool solidPageFilled;
+
+/*
+ * The page every page a map doesn't store points at. All its cells are CELL_WALL and all its floors
+ * and ceilings SURFACE_DEFAULT.
+ */
+MapPage *GetSolidMapPage()
+{
+	if (!solidPageFilled)
+	{
+		memset(solidPage.cells, CELL_WALL, sizeof(solidPage.cells));
+		memset(solidPage.floors, SURFACE_DEFAULT, sizeof(solidPage.floors));
+		memset(solidPage.ceilings, SURFACE_DEFAULT, sizeof(solidPage.ceilings));
+		solidPageFilled = true;
+	}
+	return &solidPage;
+}
+
+// Map with a page table but no pages stored, a map with no pages if the size is invalid
+static Map AllocMap(int width, int height)
+{
+	Map map = { 0 };
+	if (width <= 0 || height <= 0) { return map; }
+
+	map.pageCols = (width + MAP_PAGE_MASK) >> MAP_PAGE_SHIFT;
+	map.pageRows = (height + MAP_PAGE_MASK) >> MAP_PAGE_SHIFT;
+	map.pages = malloc((size_t)map.pageCols * map.pageRows * sizeof(MapPage *));
+	map.changes = calloc(1, sizeof(MapChanges));
+	if (map.pages == NULL || map.changes == NULL)
+	{
+		free(map.pages);
+		free(map.changes);
+		return (Map){ 0 };
+	}
+
+	MapPage *solid = GetSolidMapPage();
+	for (long i = 0; i < (long)map.pageCols * map.pageRows; i++)
+	{
+		map.pages[i] = solid;
+	}
+	map.width = width;
+	map.height = height;
+	return map;
+}
+
+/*
+ * Allocates a width x height map with every cell set to CELL_EMPTY and every floor and ceiling set
+ * to SURFACE_DEFAULT. Returns a map with no cells if the size is invalid or the allocation fails,
+ * check it with IsMapReady().
+ */
+Map LoadMapEmpty(int width, int height)
+{
+	Map map = AllocMap(width, height);
+	if (map.pages == NULL) { return map; }
+
+	for (long i = 0; i < (long)map.pageCols * map.pageRows; i++)
+	{
+		MapPage *page = calloc(1, sizeof(MapPage));
+		if (page == NULL)
+		{
+			UnloadMap(map);
+			return (Map){ 0 };
+		}
+		map.pages[i] = page;
+	}
+	return map;
+}
+
+/*
+ * Allocates a width x height map without storing any of its pages, every cell reads as wall until
+ * its page is stored with StoreMapPage(). Only the page table costs memory, meant for maps that are
+ * streamed in a page at a time.
+ */
+Map LoadMapSolid(int width, int height)
+{
+	return AllocMap(width, height);
+}
+
+/*
+ * Builds a map from a row major array of width * height values, e.g. &mapData[0][0] of a 2D array.
+ * Values too large for a MapCell are clamped to CELL_WALL.
+ */
+Map LoadMapFromArray(const unsigned int *data, int width, int height)
+{
+	Map map = LoadMapEmpty(width, height);
+	if (!IsMapReady(map)) { return map; }
+
+	for (int row = 0; row < height; row++)
+	{
+		for (int col = 0; col < width; col++)
+		{
+			const unsigned int value = data[(size_t)row * width + col];
+			GetMapPage(&map, col, row)->cells[GetMapPageIndex(col, row)] = value <= (MapCell)~0 ? (MapCell)value : CELL_WALL;
+		}
+	}
+	return map;
+}
+
+void UnloadMap(Map map)
+{
+	if (map.pages != NULL)
+	{
+		for (long i = 0; i < (long)map.pageCols * map.pageRows; i++)
+		{
+			UnloadMapPage(map.pages[i]);
+		}
+	}
+	free(map.pages);
+	free(map.changes);
+}
+
+bool IsMapReady(Map map)
+{
+	return map.pages != NULL && map.changes != NULL && map.width > 0 && map.height > 0;
+}
+
+/*
+ * Allocates a page to fill and hand to StoreMapPage(), it starts out like the solid page. Returns
+ * NULL if the allocation fails.
+ */
+MapPage *LoadMapPage()
+{
+	MapPage *page = malloc(sizeof(MapPage));
+	if (page != NULL) { memcpy(page, GetSolidMapPage(), sizeof(MapPage)); }
+	return page;
+}
+
+// Frees a page that isn't stored in a map, the solid page and NULL are ignored
+void UnloadMapPage(MapPage *page)
+{
+	if (page != GetSolidMapPage()) { free(page); }
+}
+
+/*
+ * Hands page to the map, which owns it from then on and frees it when the page is replaced or
+ * evicted or the map is unloaded. NULL evicts the page, its cells read as wall again. The page's
+ * cells are marked dirty either way. A page outside the map is freed right away.
+ */
+void StoreMapPage(Map *map, int pageCol, int pageRow, MapPage *page)
+{
+	if (page == NULL) { page = GetSolidMapPage(); }
+	if (pageCol < 0 || pageRow < 0 || pageCol >= map->pageCols || pageRow >= map->pageRows)
+	{
+		UnloadMapPage(page);
+		return;
+	}
+
+	MapPage **slot = &map->pages[(long)pageRow * map->pageCols + pageCol];
+	if (*slot != page) { UnloadMapPage(*slot); }
+	*slot = page;
+	MarkMapRegionDirty(map, pageCol * MAP_PAGE_SIZE, pageRow * MAP_PAGE_SIZE, MAP_PAGE_SIZE, MAP_PAGE_SIZE);
+}
+
+bool IsMapPageStored(const Map *map, int pageCol, int pageRow)
+{
+	if (pageCol < 0 || pageRow < 0 || pageCol >= map->pageCols || pageRow >= map->pageRows) { return false; }
+	return map->pages[(long)pageRow * map->pageCols + pageCol] != GetSolidMapPage();
+}
+
+/*
+ * Makes the page at pageCol, pageRow of target a copy of the same page of source, reusing the page
+ * target already has. A page source doesn't store is evicted from target. Both maps must be the
+ * same size. Nothing is marked dirty, meant for private copies no one subscribes to. Returns false
+ * if the page couldn't be allocated, target's page then reads as wall.
+ */
+bool CopyMapPage(Map *target, const Map *source, int pageCol, int pageRow)
+{
+	const long index = (long)pageRow * target->pageCols + pageCol;
+	MapPage *page = source->pages[index];
+	MapPage **slot = &target->pages[index];
+	if (page == GetSolidMapPage())
+	{
+		UnloadMapPage(*slot);
+		*slot = page;
+		return true;
+	}
+
+	if (*slot == GetSolidMapPage())
+	{
+		MapPage *copy = LoadMapPage();
+		if (copy == NULL) { return false; }
+		*slot = copy;
+	}
+	memcpy(*slot, page, sizeof(MapPage));
+	return true;
+}
+
+/*
+ * Copies count cells into the row starting at col, row, across as many pages as it takes. Cells
+ * outside the map or in pages it doesn't store are skipped. Like writing cells directly nothing is
+ * marked dirty, call MarkMapRegionDirty() afterwards.
+ */
+void WriteMapCells(Map *map, int col, int row, const MapCell *cells, int count)
+{
+	if (row < 0 || row >= map->height) { return; }
+
+	const int first = MAX(col, 0);
+	const int last = MIN(col + count, map->width);
+	for (int x = first; x < last; x = (x | MAP_PAGE_MASK) + 1)
+	{
+		const int length = MIN((x | MAP_PAGE_MASK) + 1, last) - x;
+		MapPage *page = GetWritableMapPage(map, x, row);
+		if (page != NULL) { memcpy(&page->cells[GetMapPageIndex(x, row)], &cells[x - col], length * sizeof(MapCell)); }
+	}
+}
+
+// Smallest region covering both
+static MapRegion MergeMapRegions(MapRegion a, MapRegion b)
+{
+	const int col = MIN(a.col, b.col);
+	const int row = MIN(a.row, b.row);
+	return (MapRegion){
+		col,
+		row,
+		MAX(a.col + a.width, b.col + b.width) - col,
+		MAX(a.row + a.height, b.row + b.height) - row
+	};
+}
+
+static long GetMapRegionArea(MapRegion region)
+{
+	return (long)region.width * region.height;
+}
+
+/*
+ * Records that the cells in the rectangle changed, clipped to the map. SetMapCell() already does
+ * this, call it after writing to a map's pages directly. Regions already covered are dropped and once
+ * the list is full new ones are merged into whichever region grows the least.
+ */
+void MarkMapRegionDirty(Map *map, int col, int row, int width, int height)
+{
+	MapRegion region = { MAX(col, 0), MAX(row, 0), 0, 0 };
+	region.width = MIN(col + width, map->width) - region.col;
+	region.height = MIN(row + height, map->height) - region.row;
+	if (map->changes == NULL || region.width <= 0 || region.height <= 0) { return; }
+
+	MapChanges *changes = map->changes;
+	int closest = -1;
+	long closestGrowth = 0;
+	for (int i = 0; i < changes->dirtyCount; i++)
+	{
+		const long growth = GetMapRegionArea(MergeMapRegions(changes->dirty[i], region)) - GetMapRegionArea(changes->dirty[i]);
+		if (growth == 0) { return; }
+		if (closest < 0 || growth < closestGrowth)
+		{
+			closest = i;
+			closestGrowth = growth;
+		}
+	}
+
+	if (changes->dirtyCount < MAP_MAX_DIRTY_REGIONS)
+	{
+		changes->dirty[changes->dirtyCount++] = region;
+	}
+	else
+	{
+		changes->dirty[closest] = MergeMapRegions(changes->dirty[closest], region);
+	}
+}
+
+/*
+ * Publishes everything marked dirty since the last commit. Bumps the version and hands each dirty
+ * region to every listener, then starts a new empty list. Does nothing if nothing changed.
+ */
+void CommitMapChanges(Map *map)
+{
+	MapChanges *changes = map->changes;
+	if (changes == NULL || changes->dirtyCount == 0) { return; }
+
+	changes->version++;
+	for (int i = 0; i < changes->dirtyCount; i++)
+	{
+		for (int l = 0; l < changes->listenerCount; l++)
+		{
+			changes->listeners[l](map, changes->dirty[i], changes->listenerData[l]);
+		}
+	}
+	changes->dirtyCount = 0;
+}
+
+/*
+ * Number of commits that changed the map since it was loaded. Cheap way to check whether anything
+ * cached from the map is still current.
+ */
+unsigned int GetMapVersion(const Map *map)
+{
+	return map->changes != NULL ? map->changes->version : 0;
+}
+
+/*
+ * Calls listener with data after every commit that changes the map. Subscribing the same listener
+ * and data twice only registers it once. Takes a const map like the readers that subscribe, only the
+ * listener list in map->changes is written, see MapChanges. Listeners have to unsubscribe before the
+ * map is unloaded or they move on to another one.
+ */
+void SubscribeMap(const Map *map, MapListener listener, void *data)
+{
+	MapChanges *changes = map->changes;
+	if (changes == NULL) { return; }
+
+	for (int i = 0; i < changes->listenerCount; i++)
+	{
+		if (changes->listeners[i] == listener && changes->listenerData[i] == data) { return; }
+	}
+	if (changes->listenerCount < MAP_MAX_LISTENERS)
+	{
+		changes->listeners[changes->listenerCount] = listener;
+		changes->listenerData[changes->listenerCount] = data;
+		changes->listenerCount++;
+	}
+}
+
+void UnsubscribeMap(const Map *map, MapListener listener, void *data)
+{
+	MapChanges *changes = map->changes;
+	if (changes == NULL) { return; }
+
+	for (int i = 0; i < changes->listenerCount; i++)
+	{
+		if (changes->listeners[i] == listener && changes->listenerData[i] == data)
+		{
+			changes->listenerCount--;
+			changes->listeners[i] = changes->listeners[changes->listenerCount];
+			changes->listenerData[i] = changes->listenerData[changes->listenerCount];
+			return;
+		}
+	}
+}
@@ -0,0 +1,295 @@
+#include "map_window.h"
+#include "helpful_math.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Pages of map that hold every cell within radius cells of position, clipped to the map. A radius
+ * of 0 covers the whole map. Snapping to pages keeps the region the same while the camera moves
+ * around inside a page, and keeps the window's corner a multiple of MAP_PAGE_SIZE so the occupancy
+ * pyramid above it has at least MAP_PAGE_SHIFT levels.
+ */
+MapRegion GetMapWindowRegion(const Map *map, Vector2 position, int radius)
+{
+	if (radius <= 0) { return (MapRegion){ 0, 0, map->width, map->height }; }
+
+	const int col = (int)floorf(position.x);
+	const int row = (int)floorf(position.y);
+	const int firstCol = (MAX(col - radius, 0) >> MAP_PAGE_SHIFT) << MAP_PAGE_SHIFT;
+	const int firstRow = (MAX(row - radius, 0) >> MAP_PAGE_SHIFT) << MAP_PAGE_SHIFT;
+	const int lastCol = MIN(((MAX(col + radius, 0) >> MAP_PAGE_SHIFT) + 1) << MAP_PAGE_SHIFT, map->width);
+	const int lastRow = MIN(((MAX(row + radius, 0) >> MAP_PAGE_SHIFT) + 1) << MAP_PAGE_SHIFT, map->height);
+	return (MapRegion){ firstCol, firstRow, MAX(lastCol - firstCol, 0), MAX(lastRow - firstRow, 0) };
+}
+
+/*
+ * Builds every copy for the cells of region. Returns a window that isn't ready if the map isn't
+ * loaded, the region is empty or an allocation fails.
+ */
+MapWindow LoadMapWindow(const Map *map, MapRegion region)
+{
+	MapWindow window = { 0 };
+	window.region = region;
+	window.occupancy = LoadOccupancyPyramid(map, region);
+	window.distanceField = LoadDistanceField(map, region);
+	window.surfaces = LoadSurfaceGrid(map, region);
+	if (!IsMapWindowReady(window))
+	{
+		UnloadMapWindow(window);
+		return (MapWindow){ 0 };
+	}
+	return window;
+}
+
+void UnloadMapWindow(MapWindow window)
+{
+	UnloadOccupancyPyramid(window.occupancy);
+	UnloadDistanceField(window.distanceField);
+	UnloadSurfaceGrid(window.surfaces);
+}
+
+bool IsMapWindowReady(MapWindow window)
+{
+	return window.occupancy.levelCount > 0 && window.distanceField.distances != NULL && window.surfaces.floors != NULL;
+}
+
+/*
+ * Brings the copies up to date after the map cells in the given rectangle changed, the part outside
+ * the window is skipped.
+ */
+void UpdateMapWindow(MapWindow *window, const Map *map, int col, int row, int width, int height)
+{
+	if (!IsMapWindowReady(*window)) { return; }
+	UpdateOccupancyPyramid(&window->occupancy, map, col, row, width, height);
+	UpdateDistanceField(&window->distanceField, map, col, row, width, height);
+	UpdateSurfaceGrid(&window->surfaces, map, col, row, width, height);
+}
+
+/*
+ * Same as UpdateMapWindow() over the whole window for when it isn't known which cells changed.
+ * The occupancy pyramid is only rebuilt above the cells that differ, the rest is copied again.
+ */
+void UpdateMapWindowFromMap(MapWindow *window, const Map *map)
+{
+	if (!IsMapWindowReady(*window)) { return; }
+	const MapRegion region = window->region;
+	UpdateOccupancyPyramidFromMap(&window->occupancy, map);
+	UpdateDistanceField(&window->distanceField, map, region.col, region.row, region.width, region.height);
+	UpdateSurfaceGrid(&window->surfaces, map, region.col, region.row, region.width, region.height);
+}
+
+/*
+ * Copies every array of source into target, which must already cover the same region.
+ */
+static void CopyMapWindowCells(MapWindow *target, const MapWindow *source)
+{
+	for (int level = 0; level < source->occupancy.levelCount; level++)
+	{
+		const OccupancyGrid *grid = &source->occupancy.levels[level];
+		memcpy(target->occupancy.levels[level].rows, grid->rows, (size_t)grid->rowWords * grid->height * sizeof(uint64_t));
+	}
+	const size_t cellCount = (size_t)source->region.width * source->region.height;
+	memcpy(target->distanceField.distances, source->distanceField.distances, cellCount);
+	memcpy(target->surfaces.floors, source->surfaces.floors, cellCount);
+	memcpy(target->surfaces.ceilings, source->surfaces.ceilings, cellCount);
+}
+
+/*
+ * Background job of StartMapWindowBuild(). Starts from a copy of the shown window and applies the
+ * changed regions when the region stayed the same, builds the window from scratch when it moved.
+ * Only reads the snapshot and the shown window, which the main thread leaves alone until it's done.
+ */
+static void BuildMapWindowJob(void *data, int first, int count)
+{
+	MapWindowBuilder *builder = data;
+	const MapWindow *shown = builder->shown;
+	const bool moved = !IsMapWindowReady(*shown) || !IsSameMapRegion(shown->region, builder->region);
+	if (moved || !IsMapWindowReady(builder->next) || !IsSameMapRegion(builder->next.region, builder->region))
+	{
+		// Nothing the same size to copy into, the snapshot is as new as anything it could copy anyway
+		UnloadMapWindow(builder->next);
+		builder->next = LoadMapWindow(&builder->snapshot, builder->region);
+		return;
+	}
+
+	CopyMapWindowCells(&builder->next, shown);
+	const MapRegion window = builder->region;
+	for (int i = 0; i < builder->jobCount; i++)
+	{
+		const MapRegion region = builder->jobRegions[i];
+		if (region.col <= window.col && region.row <= window.row &&
+			region.col + region.width >= window.col + window.width && region.row + region.height >= window.row + window.height)
+		{
+			// Changed cells unknown, only the cells that differ are rebuilt in the pyramid
+			UpdateMapWindowFromMap(&builder->next, &builder->snapshot);
+			continue;
+		}
+		UpdateMapWindow(&builder->next, &builder->snapshot, region.col, region.row, region.width, region.height);
+	}
+}
+
+/*
+ * Creates a builder for windows of map. Its snapshot starts out empty, every page is copied in by
+ * the first job that needs it. Check the result with IsMapWindowBuilderReady().
+ */
+MapWindowBuilder LoadMapWindowBuilder(const Map *map)
+{
+	MapWindowBuilder builder = { 0 };
+	if (!IsMapReady(*map)) { return builder; }
+
+	builder.snapshot = LoadMapSolid(map->width, map->height);
+	if (!IsMapReady(builder.snapshot)) { return (MapWindowBuilder){ 0 }; }
+	builder.stale = malloc((size_t)map->pageCols * map->pageRows * sizeof(bool));
+	if (builder.stale == NULL)
+	{
+		UnloadMap(builder.snapshot);
+		return (MapWindowBuilder){ 0 };
+	}
+	memset(builder.stale, true, (size_t)map->pageCols * map->pageRows * sizeof(bool));
+	return builder;
+}
+
+// Waits for the running job first, the builder can't be unloaded from under it
+void UnloadMapWindowBuilder(MapWindowBuilder *builder)
+{
+	WaitMapWindowBuild(builder);
+	UnloadMap(builder->snapshot);
+	free(builder->stale);
+	UnloadMapWindow(builder->next);
+	*builder = (MapWindowBuilder){ 0 };
+}
+
+bool IsMapWindowBuilderReady(const MapWindowBuilder *builder)
+{
+	return IsMapReady(builder->snapshot) && builder->stale != NULL;
+}
+
+/*
+ * Marks the snapshot's copy of the pages under region out of date, without rebuilding anything.
+ * For when the window itself was already brought up to date on the main thread.
+ */
+void InvalidateMapWindowSnapshot(MapWindowBuilder *builder, MapRegion region)
+{
+	if (!IsMapWindowBuilderReady(builder) || region.width <= 0 || region.height <= 0) { return; }
+
+	const Map *snapshot = &builder->snapshot;
+	const int firstCol = MAX(region.col, 0) >> MAP_PAGE_SHIFT;
+	const int firstRow = MAX(region.row, 0) >> MAP_PAGE_SHIFT;
+	const int lastCol = MIN((region.col + region.width - 1) >> MAP_PAGE_SHIFT, snapshot->pageCols - 1);
+	const int lastRow = MIN((region.row + region.height - 1) >> MAP_PAGE_SHIFT, snapshot->pageRows - 1);
+	for (int row = firstRow; row <= lastRow; row++)
+	{
+		for (int col = firstCol; col <= lastCol; col++)
+		{
+			builder->stale[(long)row * snapshot->pageCols + col] = true;
+		}
+	}
+}
+
+/*
+ * Records that the map cells in region changed, the next job applies them. Once the list is full
+ * further regions are merged into the last one.
+ */
+void QueueMapWindowChange(MapWindowBuilder *builder, MapRegion region)
+{
+	InvalidateMapWindowSnapshot(builder, region);
+	if (builder->pendingCount < MAP_MAX_DIRTY_REGIONS)
+	{
+		builder->pending[builder->pendingCount++] = region;
+		return;
+	}
+
+	MapRegion *last = &builder->pending[MAP_MAX_DIRTY_REGIONS - 1];
+	const int lastCol = MAX(last->col + last->width, region.col + region.width);
+	const int lastRow = MAX(last->row + last->height, region.row + region.height);
+	last->col = MIN(last->col, region.col);
+	last->row = MIN(last->row, region.row);
+	last->width = lastCol - last->col;
+	last->height = lastRow - last->row;
+}
+
+// Brings the snapshot's pages inside region up to date with map and drops the ones outside it
+static void RefreshMapWindowSnapshot(MapWindowBuilder *builder, const Map *map, MapRegion region)
+{
+	Map *snapshot = &builder->snapshot;
+	const int firstCol = region.col >> MAP_PAGE_SHIFT;
+	const int firstRow = region.row >> MAP_PAGE_SHIFT;
+	const int lastCol = (region.col + region.width - 1) >> MAP_PAGE_SHIFT;
+	const int lastRow = (region.row + region.height - 1) >> MAP_PAGE_SHIFT;
+	for (int row = 0; row < snapshot->pageRows; row++)
+	{
+		for (int col = 0; col < snapshot->pageCols; col++)
+		{
+			bool *stale = &builder->stale[(long)row * snapshot->pageCols + col];
+			if (col < firstCol || col > lastCol || row < firstRow || row > lastRow)
+			{
+				if (IsMapPageStored(snapshot, col, row)) { StoreMapPage(snapshot, col, row, NULL); }
+				*stale = true;
+			}
+			else if (*stale)
+			{
+				*stale = !CopyMapPage(snapshot, map, col, row);
+			}
+		}
+	}
+}
+
+/*
+ * Starts a job that builds the window for region from the current state of map, if there is
+ * anything to build: changes were queued, or shown covers a different region. Returns false
+ * without starting anything while the last job is still running, call again once it's finished.
+ * shown must stay unchanged and in place until FinishMapWindowBuild() swaps the result in.
+ */
+bool StartMapWindowBuild(MapWindowBuilder *builder, const Map *map, const MapWindow *shown, MapRegion region)
+{
+	if (!IsMapWindowBuilderReady(builder) || builder->running) { return false; }
+	if (builder->pendingCount == 0 && IsMapWindowReady(*shown) && IsSameMapRegion(shown->region, region)) { return false; }
+	if (region.width <= 0 || region.height <= 0) { return false; }
+
+	RefreshMapWindowSnapshot(builder, map, region);
+	builder->region = region;
+	builder->shown = shown;
+	builder->jobCount = builder->pendingCount;
+	memcpy(builder->jobRegions, builder->pending, (size_t)builder->pendingCount * sizeof(MapRegion));
+	builder->pendingCount = 0;
+	builder->running = true;
+	RunBackgroundJob(BuildMapWindowJob, builder, 0, 1, &builder->done);
+	return true;
+}
+
+/*
+ * Swaps the window the last job built with shown once the job is done. Only the contents swap, so
+ * pointers into shown stay valid. Returns true if shown changed.
+ */
+bool FinishMapWindowBuild(MapWindowBuilder *builder, MapWindow *shown)
+{
+	if (!builder->running || !IsJobCounterDone(&builder->done)) { return false; }
+
+	builder->running = false;
+	if (!IsMapWindowReady(builder->next))
+	{
+		// Out of memory, the next job tries the same changes again
+		for (int i = 0; i < builder->jobCount; i++)
+		{
+			QueueMapWindowChange(builder, builder->jobRegions[i]);
+		}
+		return false;
+	}
+	const MapWindow previous = *shown;
+	*shown = builder->next;
+	builder->next = previous;
+	return true;
+}
+
+// Blocks until the running job is done, FinishMapWindowBuild() still has to swap its window in
+void WaitMapWindowBuild(MapWindowBuilder *builder)
+{
+	if (builder->running) { WaitJobCounter(&builder->done); }
+}
+
+bool IsMapWindowBuilding(const MapWindowBuilder *builder)
+{
+	return builder->running;
+}
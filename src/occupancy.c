@@ -0,0 +1,191 @@
+#include "occupancy.h"
+#include "helpful_math.h"
+
+#include <stdlib.h>
+
+static void SetLineBit(uint64_t *line, int bit, bool value)
+{
+	const uint64_t mask = (uint64_t)1 << (bit & 63);
+	if (value) { line[bit >> 6] |= mask; }
+	else { line[bit >> 6] &= ~mask; }
+}
+
+/*
+ * Sets every bit from length to the end of the line's last word so the map edge reads as wall.
+ */
+static void FillLinePadding(uint64_t *line, int length, int words)
+{
+	for (int bit = length; bit < words * 64; bit++)
+	{
+		SetLineBit(line, bit, true);
+	}
+}
+
+/*
+ * Allocates an all open width x height grid starting at cell col, row, the padding past the end
+ * of each line is already set.
+ */
+static OccupancyGrid AllocOccupancyGrid(int col, int row, int width, int height)
+{
+	OccupancyGrid grid = { 0 };
+	grid.rowWords = (width + 63) / 64;
+	grid.rows = calloc((size_t)grid.rowWords * height, sizeof(uint64_t));
+	if (grid.rows == NULL) { return (OccupancyGrid){ 0 }; }
+	grid.col = col;
+	grid.row = row;
+	grid.width = width;
+	grid.height = height;
+
+	for (int line = 0; line < grid.height; line++)
+	{
+		FillLinePadding(&grid.rows[(size_t)line * grid.rowWords], grid.width, grid.rowWords);
+	}
+	return grid;
+}
+
+// col and row are map cells inside the grid
+static void SetOccupancyCell(OccupancyGrid *grid, int col, int row, bool solid)
+{
+	SetLineBit(&grid->rows[(size_t)(row - grid->row) * grid->rowWords], col - grid->col, solid);
+}
+
+/*
+ * Builds the bitmap for the cells of window, pass the whole map for a copy of all of it. Returns
+ * an empty grid (rows == NULL) if the map isn't loaded, the window is empty or the allocation fails.
+ */
+OccupancyGrid LoadOccupancyGrid(const Map *map, MapRegion window)
+{
+	if (!IsMapReady(*map) || window.width <= 0 || window.height <= 0) { return (OccupancyGrid){ 0 }; }
+
+	OccupancyGrid grid = AllocOccupancyGrid(window.col, window.row, window.width, window.height);
+	if (grid.rows != NULL)
+	{
+		UpdateOccupancyGrid(&grid, map, grid.col, grid.row, grid.width, grid.height);
+	}
+	return grid;
+}
+
+void UnloadOccupancyGrid(OccupancyGrid grid)
+{
+	free(grid.rows);
+}
+
+/*
+ * Copies the solidity of a rectangle of map cells into the bitmap, the part outside the grid is
+ * skipped. Call after editing cells of a map that already has a grid.
+ */
+void UpdateOccupancyGrid(OccupancyGrid *grid, const Map *map, int col, int row, int width, int height)
+{
+	const int lastCol = MIN(col + width, grid->col + grid->width);
+	const int lastRow = MIN(row + height, grid->row + grid->height);
+	for (int y = MAX(row, grid->row); y < lastRow; y++)
+	{
+		for (int x = MAX(col, grid->col); x < lastCol; x++)
+		{
+			SetOccupancyCell(grid, x, y, IsMapWall(map, x, y));
+		}
+	}
+}
+
+/*
+ * Marks each cell of parent solid if any of the 2x2 cells of child below it is, for the parent
+ * cells from (col, row) to (lastCol, lastRow) in the parent's cells. Child cells past the edge of
+ * the grid count as solid like everywhere else so a block is only empty if it lies entirely inside.
+ */
+static void UpdatePyramidLevel(OccupancyGrid *parent, const OccupancyGrid *child, int col, int row, int lastCol, int lastRow)
+{
+	for (int y = row; y <= lastRow; y++)
+	{
+		for (int x = col; x <= lastCol; x++)
+		{
+			const bool solid =
+				IsCellOccupied(child, x * 2, y * 2) || IsCellOccupied(child, x * 2 + 1, y * 2) ||
+				IsCellOccupied(child, x * 2, y * 2 + 1) || IsCellOccupied(child, x * 2 + 1, y * 2 + 1);
+			SetOccupancyCell(parent, x, y, solid);
+		}
+	}
+}
+
+/*
+ * Builds levels[0] from the cells of window and halves it until a single block covers the whole
+ * window, or until the window's corner can't be halved evenly any more. Page aligned windows get
+ * at least MAP_PAGE_SHIFT levels above the cells. Returns a pyramid with no levels if the map
+ * isn't loaded or an allocation fails.
+ */
+OccupancyPyramid LoadOccupancyPyramid(const Map *map, MapRegion window)
+{
+	OccupancyPyramid pyramid = { 0 };
+	pyramid.levels[0] = LoadOccupancyGrid(map, window);
+	if (pyramid.levels[0].rows == NULL) { return pyramid; }
+	pyramid.levelCount = 1;
+
+	while (pyramid.levelCount < OCCUPANCY_MAX_LEVELS)
+	{
+		const OccupancyGrid *child = &pyramid.levels[pyramid.levelCount - 1];
+		if ((child->width == 1 && child->height == 1) || (child->col & 1) != 0 || (child->row & 1) != 0) { break; }
+
+		OccupancyGrid parent = AllocOccupancyGrid(child->col / 2, child->row / 2, (child->width + 1) / 2, (child->height + 1) / 2);
+		if (parent.rows == NULL)
+		{
+			UnloadOccupancyPyramid(pyramid);
+			return (OccupancyPyramid){ 0 };
+		}
+		UpdatePyramidLevel(&parent, child, parent.col, parent.row, parent.col + parent.width - 1, parent.row + parent.height - 1);
+		pyramid.levels[pyramid.levelCount++] = parent;
+	}
+	return pyramid;
+}
+
+void UnloadOccupancyPyramid(OccupancyPyramid pyramid)
+{
+	for (int level = 0; level < pyramid.levelCount; level++)
+	{
+		UnloadOccupancyGrid(pyramid.levels[level]);
+	}
+}
+
+/*
+ * Incremental rebuild after cells of the map changed. Only the blocks covering the given rectangle
+ * of map cells are recomputed on each level, the part outside the window is skipped.
+ */
+void UpdateOccupancyPyramid(OccupancyPyramid *pyramid, const Map *map, int col, int row, int width, int height)
+{
+	if (pyramid->levelCount == 0 || width <= 0 || height <= 0) { return; }
+	const OccupancyGrid *cells = &pyramid->levels[0];
+	UpdateOccupancyGrid(&pyramid->levels[0], map, col, row, width, height);
+
+	// Rectangle in the current level's cells, clamped to the level
+	int firstCol = MAX(col, cells->col);
+	int firstRow = MAX(row, cells->row);
+	int lastCol = MIN(col + width, cells->col + cells->width) - 1;
+	int lastRow = MIN(row + height, cells->row + cells->height) - 1;
+	for (int level = 1; level < pyramid->levelCount && firstCol <= lastCol && firstRow <= lastRow; level++)
+	{
+		firstCol /= 2;
+		firstRow /= 2;
+		lastCol /= 2;
+		lastRow /= 2;
+		UpdatePyramidLevel(&pyramid->levels[level], &pyramid->levels[level - 1], firstCol, firstRow, lastCol, lastRow);
+	}
+}
+
+/*
+ * Incremental rebuild when it isn't known which cells changed. Compares every cell of the window
+ * with levels[0] and only rebuilds the blocks above the ones that differ.
+ */
+void UpdateOccupancyPyramidFromMap(OccupancyPyramid *pyramid, const Map *map)
+{
+	if (pyramid->levelCount == 0) { return; }
+
+	const OccupancyGrid *cells = &pyramid->levels[0];
+	for (int row = cells->row; row < cells->row + cells->height; row++)
+	{
+		for (int col = cells->col; col < cells->col + cells->width; col++)
+		{
+			if (IsMapWall(map, col, row) != IsCellOccupied(cells, col, row))
+			{
+				UpdateOccupancyPyramid(pyramid, map, col, row, 1, 1);
+			}
+		}
+	}
+}
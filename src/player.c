@@ -1,9 +1,15 @@
 #include "player.h"
 #include "helpful_math.h"
+#include "collision.h"
 
-static int map[10][10];
+#include <stddef.h>
 
-void CreatePlayer(Vector2 init_position, float init_rotation, float move_speed, float rotate_speed, float collider_radius, unsigned int map_data[10][10])
+// Not owned by the player, read directly by CanMove() and MovePlayer()
+static const Map *map;
+// Optional, lets CanMove() and MovePlayer() skip the wall tests when nothing is in reach
+static const DistanceField *distanceField;
+
+void CreatePlayer(Vector2 init_position, float init_rotation, float move_speed, float rotate_speed, float collider_radius, const Map *map_data)
 {
 	player.position = init_position;
 	player.rotation = init_rotation;
@@ -14,16 +20,30 @@ void CreatePlayer(Vector2 init_position, float init_rotation, float move_speed,
 	UpdatePlayerMapData(map_data);
 }
 
-void UpdatePlayerMapData(unsigned int map_data[10][10])
+void UpdatePlayerMapData(const Map *map_data)
+{
+	map = map_data;
+}
+
+void UpdatePlayerDistanceField(const DistanceField *field)
+{
+	distanceField = field;
+}
+
+/*
+ * Moves the player towards target, sliding along any wall in the way instead of stopping dead.
+ * With a distance field, a target with more clearance than the collider plus the length of the move
+ * can't have a wall anywhere along the way and is taken as is.
+ */
+static void MovePlayer(Vector2 target)
 {
-	// Copy over each value from new map data
-	for (int row = 0; row < 10; row++)
+	const float reach = player.collider_radius + Vector2Distance(player.position, target);
+	if (distanceField != NULL && GetDistanceFieldClearance(distanceField, target) >= reach)
 	{
-		for (int col = 0; col < 10; col++)
-		{
-			map[row][col] = map_data[row][col];
-		}
+		player.position = target;
+		return;
 	}
+	player.position = MoveCircle(map, NULL, player.position, target, player.collider_radius, NULL);
 }
 
 /*
@@ -57,7 +77,7 @@ void PlayerInput()
 			),
 			player.position
 		);
-		if (CanMove(new_position)) { player.position = new_position; }
+		MovePlayer(new_position);
 	}
 	// Move Backward
 	else if (IsKeyDown(KEY_S) || IsKeyDown(KEY_DOWN))
@@ -69,44 +89,20 @@ void PlayerInput()
 			),
 			player.position
 		);
-		if (CanMove(new_position)) { player.position = new_position; }
+		MovePlayer(new_position);
 	}
 }
 
 /*
- * Check if the Player can move to the new position. Called when trying to mvoe forward or backward.
- * Checks if the spaces in the cardinal directions (up, down, left, right) contain a wall. If
- * they do contain a wall, an AABB collision check is made. If no collisions are found between any
- * of the walls, returns true meaning the player can move to the new position.
+ * Check if the Player can stand at the new position. Tests the collider against every cell it could
+ * touch, diagonal neighbours included. With a distance field the common case of no wall within
+ * reach is answered without looking at the map.
  */
 bool CanMove(Vector2 position)
 {
-	bool hitDown = false;
-	bool hitLeft = false;
-	bool hitRight = false;
-	bool hitUp = false;
-	Rectangle wall;
-
-	if (map[(int)position.y][(int)position.x + 1] == 1)
-	{
-		wall = (Rectangle){ (int)position.x + 1, (int)position.y, 1.0f, 1.0f };
-		hitRight = CheckCollisionCircleRec(position, player.collider_radius, wall);
-	}
-	if (map[(int)position.y][(int)position.x - 1] == 1)
-	{
-		wall = (Rectangle){ (int)position.x - 1, (int)position.y, 1.0f, 1.0f };
-		hitLeft = CheckCollisionCircleRec(position, player.collider_radius, wall);
-	}
-	if (map[(int)position.y + 1][(int)position.x] == 1)
-	{
-		wall = (Rectangle){ (int)position.x, (int)position.y + 1, 1.0f, 1.0f };
-		hitDown = CheckCollisionCircleRec(position, player.collider_radius, wall);
-	}
-	if (map[(int)position.y - 1][(int)position.x] == 1)
+	if (distanceField != NULL && GetDistanceFieldClearance(distanceField, position) >= player.collider_radius)
 	{
-		wall = (Rectangle){ (int)position.x, (int)position.y - 1, 1.0f, 1.0f };
-		hitUp = CheckCollisionCircleRec(position, player.collider_radius, wall);
+		return true;
 	}
-
-	return !hitDown && !hitLeft && !hitRight && !hitUp;
+	return IsCircleClear(map, NULL, position, player.collider_radius);
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "projection.h"
+#include "helpful_math.h"
+
+#include <stdlib.h>
+
+/*
+ * Builds the cast angle, camera relative direction and fisheye correction (cos of the cast angle)
+ * for all rayCount + 1 columns. The angles use the same non-linear spacing as DDANonLinear(), see
+ * https://www.scottsmitelli.com/articles/we-can-fix-your-raycaster/.
+ */
+ProjectionTable LoadProjectionTable(unsigned int rayCount, unsigned int fov, unsigned int viewportWidth, float drawDistance)
+{
+	ProjectionTable table = { 0 };
+	table.rayCount = rayCount;
+	table.fov = fov;
+	table.castAngles = malloc((rayCount + 1) * sizeof(float));
+	table.directions = malloc((rayCount + 1) * sizeof(Vector2));
+	table.corrections = malloc((rayCount + 1) * sizeof(float));
+
+	const unsigned int half_fov = fov / 2;
+	const float xMax = (float)(viewportWidth - 1);
+	const float projection_plane_half_width = drawDistance * tanf(DEG2RAD * half_fov);
+	const unsigned int xPixelWidth = viewportWidth / rayCount;
+	const unsigned int half_ray_count = rayCount / 2;
+
+	for (unsigned int i = 0; i <= half_ray_count; i++)
+	{
+		float xScreen = i * xPixelWidth;
+		float X_PROJECTION_PLANE = (((float)(xScreen * 2) - xMax) / xMax) * (projection_plane_half_width);
+		float castAngle = atan2f(X_PROJECTION_PLANE, drawDistance);
+
+		table.castAngles[i] = castAngle;
+		table.castAngles[rayCount - i] = -castAngle;
+	}
+
+	for (unsigned int i = 0; i <= rayCount; i++)
+	{
+		table.directions[i] = (Vector2){ cosf(table.castAngles[i]), sinf(table.castAngles[i]) };
+		table.corrections[i] = cosf(table.castAngles[i]);
+	}
+
+	return table;
+}
+
+void UnloadProjectionTable(ProjectionTable table)
+{
+	free(table.castAngles);
+	free(table.directions);
+	free(table.corrections);
+}
+
+/*
+ * Rotates every column direction by the camera angle. This is the only trig left per frame.
+ */
+void RotateProjectionTable(const ProjectionTable *table, float angleDegrees, Vector2 forward[])
+{
+	const float c = cosf(angleDegrees * DEG2RAD);
+	const float s = sinf(angleDegrees * DEG2RAD);
+
+	for (unsigned int i = 0; i <= table->rayCount; i++)
+	{
+		Vector2 direction = table->directions[i];
+		forward[i] = (Vector2){
+			(direction.x * c) - (direction.y * s),
+			(direction.x * s) + (direction.y * c)
+		};
+	}
+}
@@ -0,0 +1,101 @@
+#include "pyramid_dda.h"
+#include "helpful_math.h"
+
+// Stand-in for the distance to a grid line the ray runs parallel to
+#define NO_STEP 1e30f
+
+/*
+ * Distance along the ray to the vertical (or horizontal) grid line at line, inverseDir is 1 / the
+ * ray direction along that axis. Rays that never move along that axis never reach it.
+ */
+static float DistanceToLine(float line, float start, float inverseDir)
+{
+	return inverseDir != 0.0f ? (line - start) * inverseDir : NO_STEP;
+}
+
+/*
+ * Hierarchical DDA over the occupancy pyramid. Each step climbs to the largest open block around
+ * the current cell and crosses straight to the far side of it, dropping back down a level whenever
+ * the block turns out to hold a wall. Every grid line it crosses without stopping lies inside an
+ * open block, so it stops at exactly the same wall and distance as stepping one cell at a time.
+ */
+static void CastRayPyramid(struct RayData *ray, Vector2 forward, float correction, Vector2 position, const OccupancyPyramid *pyramid, float maxDistance)
+{
+	const OccupancyGrid *cells = &pyramid->levels[0];
+	const int dirX = forward.x < 0 ? -1 : 1;
+	const int dirY = forward.y < 0 ? -1 : 1;
+	// Zero on an axis the ray doesn't move along, see DistanceToLine()
+	const float inverseX = forward.x != 0.0f ? 1.0f / forward.x : 0.0f;
+	const float inverseY = forward.y != 0.0f ? 1.0f / forward.y : 0.0f;
+
+	// Convert pixel coords into map grid coords
+	int mapCol = position.x;
+	int mapRow = position.y;
+	int level = 0;
+	// Blocks that reach past the draw distance are never crossed whole, the last few steps before
+	// it are taken at the level that keeps them inside it so the ray stops where the scalar loop does
+	int maxLevel = pyramid->levelCount - 1;
+	bool hitX = false;
+	float distanceChecked = 0.0f;
+
+	int steps = 0;
+	bool hitWall = false;
+	while (!hitWall && distanceChecked < maxDistance)
+	{
+		// Largest open block around the current cell. Level 0 is the cell itself, which the ray is
+		// already in so it is open.
+		while (level > 0 && IsCellOccupied(&pyramid->levels[level], mapCol >> level, mapRow >> level)) { level--; }
+		while (level < maxLevel && !IsCellOccupied(&pyramid->levels[level + 1], mapCol >> (level + 1), mapRow >> (level + 1))) { level++; }
+
+		const int size = 1 << level;
+		const int blockCol = (mapCol >> level) << level;
+		const int blockRow = (mapRow >> level) << level;
+		const float lengthX = DistanceToLine((float)(dirX > 0 ? blockCol + size : blockCol), position.x, inverseX);
+		const float lengthY = DistanceToLine((float)(dirY > 0 ? blockRow + size : blockRow), position.y, inverseY);
+		const float length = MIN(lengthX, lengthY);
+		if (level > 0 && length >= maxDistance)
+		{
+			maxLevel = level - 1;
+			level = maxLevel;
+			continue;
+		}
+
+		// Step along shortest length into the cell on the far side of the block
+		hitX = lengthX < lengthY;
+		if (hitX)
+		{
+			mapCol = dirX > 0 ? blockCol + size : blockCol - 1;
+			mapRow = MIN(MAX((int)floorf(position.y + forward.y * length), blockRow), blockRow + size - 1);
+		}
+		else
+		{
+			mapRow = dirY > 0 ? blockRow + size : blockRow - 1;
+			mapCol = MIN(MAX((int)floorf(position.x + forward.x * length), blockCol), blockCol + size - 1);
+		}
+		distanceChecked = length;
+		steps++;
+
+		hitWall = IsCellOccupied(cells, mapCol, mapRow);
+	}
+
+	ray->start = position;
+	ray->end = Vector2Add(position, Vector2Scale(forward, distanceChecked));
+	// Save for rendering shadowed walls
+	ray->hitX = hitX;
+	ray->distance = distanceChecked * correction;
+	ray->offset = fmodf(hitX ? ray->end.y : ray->end.x, 1.0f);
+	ray->steps = steps;
+}
+
+/*
+ * Casts rays[first] to rays[first + count - 1] over the occupancy pyramid. Takes the same
+ * per-ray directions and fisheye corrections as CastRayPackets(). Pays off when the draw distance
+ * is long and rays cross large open areas, near walls it costs about the same as the scalar loop.
+ */
+void CastRaysPyramid(struct RayData rays[], const Vector2 forward[], const float correction[], int first, int count, Vector2 position, const OccupancyPyramid *pyramid, float maxDistance)
+{
+	for (int i = first; i < first + count; i++)
+	{
+		CastRayPyramid(&rays[i], forward[i], correction[i], position, pyramid, maxDistance);
+	}
+}
@@ -0,0 +1,286 @@
+#include "ray_packet.h"
+#include "helpful_math.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define RAY_PACKET_X86
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#endif
+
+// GCC and Clang only emit vector instructions for functions that ask for them, MSVC always allows them
+#if defined(__GNUC__) || defined(__clang__)
+	#define TARGET_SSE2 __attribute__((target("sse2")))
+	#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+	#define TARGET_SSE2
+	#define TARGET_AVX2
+#endif
+
+// Stand-in for 1 / 0 on an axis the ray never moves along, keeps that axis from ever being the shortest step
+#define NO_STEP 1e30f
+
+static RayPacketWidth DetectRayPacketWidth()
+{
+#if defined(RAY_PACKET_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7)
+	{
+		__cpuid(info, 1);
+		bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		bool hasAvx2 = (info[1] & (1 << 5)) != 0;
+		if (osSavesYmm && hasAvx2) { return PACKET_AVX2; }
+	}
+	// SSE2 is part of every x64 CPU and is MSVC's default for x86
+	return PACKET_SSE;
+#elif defined(RAY_PACKET_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) { return PACKET_AVX2; }
+	if (__builtin_cpu_supports("sse2")) { return PACKET_SSE; }
+	return PACKET_SCALAR;
+#else
+	return PACKET_SCALAR;
+#endif
+}
+
+RayPacketWidth GetRayPacketWidth()
+{
+	static RayPacketWidth width = 0;
+	if (width == 0) { width = DetectRayPacketWidth(); }
+	return width;
+}
+
+/*
+ * Writes the final result of one lane back to its ray. Matches what the scalar loop in
+ * DDANonLinear() stores so both paths can be swapped freely.
+ */
+static void StoreRayHit(struct RayData *ray, Vector2 position, Vector2 forward, float correction, float distance, bool hitX, int steps)
+{
+	ray->start = position;
+	ray->end = Vector2Add(position, Vector2Scale(forward, distance));
+	ray->hitX = hitX;
+	ray->distance = distance * correction;
+	ray->offset = fmodf(hitX ? ray->end.y : ray->end.x, 1.0f);
+	ray->steps = steps;
+}
+
+#if defined(RAY_PACKET_X86)
+
+TARGET_SSE2 static inline __m128 SelectSSE(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/*
+ * Traverses 4 adjacent rays at once. Every lane runs the same DDA as the scalar loop, lanes that
+ * already hit a wall or ran out of draw distance are masked off until the whole packet is done.
+ * SSE has no gather so the map lookup is still done one active lane at a time.
+ */
+TARGET_SSE2 static void CastRayPacketsSSE(struct RayData rays[], const Vector2 forward[], const float correction[], int first, int count, Vector2 position, const OccupancyGrid *grid, float maxDistance)
+{
+	const int startCol = (int)position.x;
+	const int startRow = (int)position.y;
+	const __m128 posX = _mm_set1_ps(position.x);
+	const __m128 posY = _mm_set1_ps(position.y);
+	const __m128 cellX = _mm_set1_ps((float)startCol);
+	const __m128 cellY = _mm_set1_ps((float)startRow);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 minDir = _mm_set1_ps(1.0f / NO_STEP);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 drawDistance = _mm_set1_ps(maxDistance);
+
+	for (int base = first; base < first + count; base += PACKET_SSE)
+	{
+		const int lanes = MIN(PACKET_SSE, first + count - base);
+		float dirX[PACKET_SSE], dirY[PACKET_SSE];
+		for (int lane = 0; lane < PACKET_SSE; lane++)
+		{
+			// Pad a short final packet by repeating its last ray, padded lanes are never stored
+			Vector2 f = forward[base + MIN(lane, lanes - 1)];
+			dirX[lane] = f.x;
+			dirY[lane] = f.y;
+		}
+		const __m128 fx = _mm_loadu_ps(dirX);
+		const __m128 fy = _mm_loadu_ps(dirY);
+
+		// For a unit direction, 1 unit in x = sqrt[1^2 + (dy/dx)^2] = 1 / |dx|
+		const __m128 stepX = _mm_div_ps(one, _mm_max_ps(_mm_and_ps(fx, absMask), minDir));
+		const __m128 stepY = _mm_div_ps(one, _mm_max_ps(_mm_and_ps(fy, absMask), minDir));
+		const __m128 negX = _mm_cmplt_ps(fx, zero);
+		const __m128 negY = _mm_cmplt_ps(fy, zero);
+		// All bits set (-1) OR 1 stays -1, zero OR 1 becomes 1
+		const __m128i dirCol = _mm_or_si128(_mm_castps_si128(negX), _mm_set1_epi32(1));
+		const __m128i dirRow = _mm_or_si128(_mm_castps_si128(negY), _mm_set1_epi32(1));
+
+		__m128 rayLengthX = _mm_mul_ps(SelectSSE(negX, _mm_sub_ps(posX, cellX), _mm_sub_ps(_mm_add_ps(cellX, one), posX)), stepX);
+		__m128 rayLengthY = _mm_mul_ps(SelectSSE(negY, _mm_sub_ps(posY, cellY), _mm_sub_ps(_mm_add_ps(cellY, one), posY)), stepY);
+		__m128i mapCol = _mm_set1_epi32(startCol);
+		__m128i mapRow = _mm_set1_epi32(startRow);
+		__m128 distanceChecked = zero;
+		__m128 hitX = zero;
+		__m128 active = _mm_cmpeq_ps(zero, zero);
+		__m128i steps = _mm_setzero_si128();
+
+		int activeBits;
+		while ((activeBits = _mm_movemask_ps(active)) != 0)
+		{
+			// Step along shortest length
+			const __m128 takeX = _mm_and_ps(_mm_cmplt_ps(rayLengthX, rayLengthY), active);
+			const __m128 takeY = _mm_andnot_ps(takeX, active);
+			// Active lanes are all bits set, -1, so subtracting counts one step for each
+			steps = _mm_sub_epi32(steps, _mm_castps_si128(active));
+
+			mapCol = _mm_add_epi32(mapCol, _mm_and_si128(dirCol, _mm_castps_si128(takeX)));
+			mapRow = _mm_add_epi32(mapRow, _mm_and_si128(dirRow, _mm_castps_si128(takeY)));
+			distanceChecked = SelectSSE(takeX, rayLengthX, SelectSSE(takeY, rayLengthY, distanceChecked));
+			rayLengthX = _mm_add_ps(rayLengthX, _mm_and_ps(stepX, takeX));
+			rayLengthY = _mm_add_ps(rayLengthY, _mm_and_ps(stepY, takeY));
+			hitX = SelectSSE(active, takeX, hitX);
+
+			int cols[PACKET_SSE], rows[PACKET_SSE], solid[PACKET_SSE];
+			_mm_storeu_si128((__m128i *)cols, mapCol);
+			_mm_storeu_si128((__m128i *)rows, mapRow);
+			for (int lane = 0; lane < PACKET_SSE; lane++)
+			{
+				solid[lane] = (activeBits & (1 << lane)) && IsCellOccupied(grid, cols[lane], rows[lane]) ? -1 : 0;
+			}
+			active = _mm_andnot_ps(_mm_castsi128_ps(_mm_loadu_si128((const __m128i *)solid)), active);
+			active = _mm_and_ps(active, _mm_cmplt_ps(distanceChecked, drawDistance));
+		}
+
+		float distances[PACKET_SSE];
+		int laneSteps[PACKET_SSE];
+		_mm_storeu_ps(distances, distanceChecked);
+		_mm_storeu_si128((__m128i *)laneSteps, steps);
+		const int hitXBits = _mm_movemask_ps(hitX);
+		for (int lane = 0; lane < lanes; lane++)
+		{
+			StoreRayHit(&rays[base + lane], position, forward[base + lane], correction[base + lane], distances[lane], (hitXBits & (1 << lane)) != 0, laneSteps[lane]);
+		}
+	}
+}
+
+/*
+ * Same traversal as CastRayPacketsSSE() on 8 lanes. AVX2 can gather the occupancy words of every
+ * active lane in one instruction, each lane then shifts its own cell's bit down. Lanes outside the
+ * grid are left with every bit set so they read as wall.
+ */
+TARGET_AVX2 static void CastRayPacketsAVX2(struct RayData rays[], const Vector2 forward[], const float correction[], int first, int count, Vector2 position, const OccupancyGrid *grid, float maxDistance)
+{
+	const int startCol = (int)position.x;
+	const int startRow = (int)position.y;
+	const __m256 posX = _mm256_set1_ps(position.x);
+	const __m256 posY = _mm256_set1_ps(position.y);
+	const __m256 cellX = _mm256_set1_ps((float)startCol);
+	const __m256 cellY = _mm256_set1_ps((float)startRow);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 minDir = _mm256_set1_ps(1.0f / NO_STEP);
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	const __m256 drawDistance = _mm256_set1_ps(maxDistance);
+	const __m256i width = _mm256_set1_epi32(grid->width);
+	const __m256i height = _mm256_set1_epi32(grid->height);
+	// rows[] read as 32 bit words, 64 bit words are little endian so the low half holds the first 32 cells
+	const __m256i rowStride = _mm256_set1_epi32(grid->rowWords * 2);
+	const __m256i bitMask = _mm256_set1_epi32(31);
+	const __m256i one32 = _mm256_set1_epi32(1);
+	const __m256i minusOne = _mm256_set1_epi32(-1);
+
+	for (int base = first; base < first + count; base += PACKET_AVX2)
+	{
+		const int lanes = MIN(PACKET_AVX2, first + count - base);
+		float dirX[PACKET_AVX2], dirY[PACKET_AVX2];
+		for (int lane = 0; lane < PACKET_AVX2; lane++)
+		{
+			// Pad a short final packet by repeating its last ray, padded lanes are never stored
+			Vector2 f = forward[base + MIN(lane, lanes - 1)];
+			dirX[lane] = f.x;
+			dirY[lane] = f.y;
+		}
+		const __m256 fx = _mm256_loadu_ps(dirX);
+		const __m256 fy = _mm256_loadu_ps(dirY);
+
+		const __m256 stepX = _mm256_div_ps(one, _mm256_max_ps(_mm256_and_ps(fx, absMask), minDir));
+		const __m256 stepY = _mm256_div_ps(one, _mm256_max_ps(_mm256_and_ps(fy, absMask), minDir));
+		const __m256 negX = _mm256_cmp_ps(fx, zero, _CMP_LT_OQ);
+		const __m256 negY = _mm256_cmp_ps(fy, zero, _CMP_LT_OQ);
+		const __m256i dirCol = _mm256_or_si256(_mm256_castps_si256(negX), _mm256_set1_epi32(1));
+		const __m256i dirRow = _mm256_or_si256(_mm256_castps_si256(negY), _mm256_set1_epi32(1));
+
+		__m256 rayLengthX = _mm256_mul_ps(_mm256_blendv_ps(_mm256_sub_ps(_mm256_add_ps(cellX, one), posX), _mm256_sub_ps(posX, cellX), negX), stepX);
+		__m256 rayLengthY = _mm256_mul_ps(_mm256_blendv_ps(_mm256_sub_ps(_mm256_add_ps(cellY, one), posY), _mm256_sub_ps(posY, cellY), negY), stepY);
+		// Cells counted from the grid's corner, the lengths only depend on where the ray started
+		__m256i mapCol = _mm256_set1_epi32(startCol - grid->col);
+		__m256i mapRow = _mm256_set1_epi32(startRow - grid->row);
+		__m256 distanceChecked = zero;
+		__m256 hitX = zero;
+		__m256 active = _mm256_castsi256_ps(minusOne);
+		__m256i steps = _mm256_setzero_si256();
+
+		while (_mm256_movemask_ps(active) != 0)
+		{
+			// Step along shortest length
+			const __m256 takeX = _mm256_and_ps(_mm256_cmp_ps(rayLengthX, rayLengthY, _CMP_LT_OQ), active);
+			const __m256 takeY = _mm256_andnot_ps(takeX, active);
+			steps = _mm256_sub_epi32(steps, _mm256_castps_si256(active));
+
+			mapCol = _mm256_add_epi32(mapCol, _mm256_and_si256(dirCol, _mm256_castps_si256(takeX)));
+			mapRow = _mm256_add_epi32(mapRow, _mm256_and_si256(dirRow, _mm256_castps_si256(takeY)));
+			distanceChecked = _mm256_blendv_ps(_mm256_blendv_ps(distanceChecked, rayLengthY, takeY), rayLengthX, takeX);
+			rayLengthX = _mm256_add_ps(rayLengthX, _mm256_and_ps(stepX, takeX));
+			rayLengthY = _mm256_add_ps(rayLengthY, _mm256_and_ps(stepY, takeY));
+			hitX = _mm256_blendv_ps(hitX, takeX, active);
+
+			__m256i inside = _mm256_and_si256(
+				_mm256_and_si256(_mm256_cmpgt_epi32(mapCol, minusOne), _mm256_cmpgt_epi32(width, mapCol)),
+				_mm256_and_si256(_mm256_cmpgt_epi32(mapRow, minusOne), _mm256_cmpgt_epi32(height, mapRow))
+			);
+			__m256i gatherMask = _mm256_and_si256(inside, _mm256_castps_si256(active));
+			__m256i index = _mm256_add_epi32(_mm256_mullo_epi32(mapRow, rowStride), _mm256_srli_epi32(mapCol, 5));
+			__m256i words = _mm256_mask_i32gather_epi32(minusOne, (const int *)grid->rows, index, gatherMask, 4);
+			__m256i solid = _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_and_si256(mapCol, bitMask)), one32);
+
+			active = _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(solid, one32)), active);
+			active = _mm256_and_ps(active, _mm256_cmp_ps(distanceChecked, drawDistance, _CMP_LT_OQ));
+		}
+
+		float distances[PACKET_AVX2];
+		int laneSteps[PACKET_AVX2];
+		_mm256_storeu_ps(distances, distanceChecked);
+		_mm256_storeu_si256((__m256i *)laneSteps, steps);
+		const int hitXBits = _mm256_movemask_ps(hitX);
+		for (int lane = 0; lane < lanes; lane++)
+		{
+			StoreRayHit(&rays[base + lane], position, forward[base + lane], correction[base + lane], distances[lane], (hitXBits & (1 << lane)) != 0, laneSteps[lane]);
+		}
+	}
+}
+
+#endif
+
+/*
+ * Casts rays[first] to rays[first + count - 1] in packets of GetRayPacketWidth() adjacent rays.
+ * Each ray needs its unit direction in forward[] and its fisheye correction in correction[]. Returns false
+ * without touching the rays when this CPU has no packet path, the caller should then use the
+ * scalar loop instead.
+ */
+bool CastRayPackets(struct RayData rays[], const Vector2 forward[], const float correction[], int first, int count, Vector2 position, const OccupancyGrid *grid, float maxDistance)
+{
+	switch (GetRayPacketWidth())
+	{
+#if defined(RAY_PACKET_X86)
+	case PACKET_AVX2:
+		CastRayPacketsAVX2(rays, forward, correction, first, count, position, grid, maxDistance);
+		return true;
+	case PACKET_SSE:
+		CastRayPacketsSSE(rays, forward, correction, first, count, position, grid, maxDistance);
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
@@ -1,6 +1,27 @@
 #include "renderer.h"
 #include "resource_dir.h"
 #include "helpful_math.h"
+#include "ray_packet.h"
+#include "job_system.h"
+#include "projection.h"
+#include "fixed_dda.h"
+#include "map.h"
+#include "occupancy.h"
+#include "pyramid_dda.h"
+#include "distance_field.h"
+#include "sphere_dda.h"
+#include "angle_cache.h"
+#include "texture_atlas.h"
+#include "wall_batch.h"
+#include "floor_cast.h"
+#include "map_window.h"
+#include "sprite.h"
+#include "spatial_hash.h"
+#include "rlgl.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define RAYGUI_IMPLEMENTATION
 #include "raygui.h"
@@ -8,25 +29,107 @@
 
 #define MIN_SCREEN_WIDTH 640
 #define MIN_SCREEN_HEIGHT 480
-#define VIEWPORT_WIDTH 640
-#define VIEWPORT_HEIGHT 480
 #define DRAW_DISTANCE 20
 #define X_MAX (VIEWPORT_WIDTH - 1)
+#define MIN_AUTOMAP_TILE_SIZE 8	// Pixels per cell, maps too large to fit scroll with the camera instead
+#define RAY_CHUNK_SIZE 32	// Rays per job, kept a multiple of the widest ray packet
+#define COHERENT_RAY_SPACING 16	// Rays always cast by coherent casting, the ones between may be interpolated
+#define FLOOR_ROW_CHUNK_SIZE 16	// Floor and ceiling row pairs per job
+#define DEFAULT_FLOOR_TEXTURE 6		// Index into atlasTextureFiles for SURFACE_DEFAULT floors
+#define DEFAULT_CEILING_TEXTURE 3	// and ceilings
+#define LIGHT_RANGE 4.0f	// Distance lit fully by the player, lower number reduces amount of "light" emitted
+#define WALL_TEXTURE_COUNT 8	// Leading entries of atlasTextureFiles map cells can use
+#define SPRITE_NEAR_DISTANCE 0.1f	// Sprites closer to the camera than this are skipped
+#define SPRITE_BATCH_CAPACITY 16000	// Sprite quads per frame, 4 vertices each have to fit 16 bit indices
+#define SPRITE_COLUMN_CHUNK_SIZE 32	// Columns per sprite drawing job
+
+// Textures packed into the atlas. Wall, floor and ceiling textures come first in the order map
+// cells pick them, cell CELL_WALL + i uses atlasTextureFiles[i]. Sprite textures follow.
+static const char *const atlasTextureFiles[] = {
+	"checkerboard64.png",
+	"grey_brick_32.png",
+	"red_brick.png",
+	"metal.png",
+	"grey_brick_64.png",
+	"grey_brick_128.png",
+	"checkerboard.png",
+	"checkerboard2.png",
+	"wabbit_alpha.png"
+};
 
 static Renderer renderer;
 static enum DrawMode drawMode = GAME;
-static enum ShadingMdoe shadingMode = TEXTURED;
+static enum ShadingMode shadingMode = TEXTURED;
 static enum RenderQuality renderQuality = ULTRA;
 static enum GameMode gameMode = MAIN_MENU;
+static enum TraversalMode traversalMode = DDA_PACKET;
+static bool coherentRays = false;
+static bool rotationCache = false;
+// Walls and sprites drawn through the GL batches of wall_batch.c instead of per column. Off until
+// that path has been checked on real GL 3.3 and ES2 contexts, see UpdateBatchedWalls().
+static bool batchedWalls = false;
+// Set whenever something drawn into renderTex changes, UpdateFrameBuffer() skips frames without it
+static bool frameDirty = true;
+static enum RenderBackend renderBackend = BACKEND_RAYLIB;
 // Auto fill with largest amount, can't resize smaller in C without too much dynamic allocation overhead for array this small.
 // Basically fill it with the width of the game viewport and add 1
 static struct RayData rays[VIEWPORT_WIDTH + 1];
-static int map[10][10];
+// Unit direction of each ray for the current frame, filled by DDANonLinear() before casting
+static Vector2 rayForward[VIEWPORT_WIDTH + 1];
+// Cast angles, directions and fisheye correction per column, only rebuilt when FOV or ray count change
+static ProjectionTable projection;
+// Binary angle of each column for DDA_FIXED, rebuilt alongside the projection table
+static BinaryAngle fixedColumnAngles[VIEWPORT_WIDTH + 1];
+// Not owned by the renderer, whoever loaded the map keeps it alive until it is replaced
+static const Map *map;
+// Copies of the map around the camera. The occupancy bitmaps are read by DDANonLinear(), levels[0]
+// is small enough to stay in cache and the coarser levels let DDA_PYRAMID jump across open areas.
+// The distance field is used by DDA_SPHERE and shared with collision checks, the surfaces by the
+// floor casting. The window follows the camera, see UpdateRendererMapWindow(). Map commits and
+// camera moves rebuild it on a background job, see UpdateMapWindowBuild().
+static MapWindow mapWindow;
+static MapWindowBuilder mapWindowBuilder;
+static int mapWindowRadius;	// Cells kept around the camera, 0 keeps the whole map
+// Wall hits around the camera position, reused by DDANonLinear() while the camera only turns
+static AngleCache angleCache;
+// Atlas rect of every floor and ceiling value, rebuilt with the atlas
+static SurfaceTextures surfaceTextures;
+// Not owned by the renderer, see UpdateRendererSprites()
+static const Sprite *sprites;
+static int spriteCount;
+// Sprites that passed culling this frame sorted back to front, and room for sorting them
+static ProjectedSprite *visibleSprites;
+static ProjectedSprite *spriteScratch;
+static int spriteCapacity;
+static int visibleSpriteCount;
+// Sprites filed by cell, only the ones near cells the rays crossed are copied to candidateSprites
+// and projected, see CollectSpriteCandidates()
+static SpatialHash spriteHash;
+static Sprite *candidateSprites;
+static int spriteReach;		// Cells the largest sprite pokes out of the cell it stands in
+
+// Frame stamps of the cells around the camera, see CollectSpriteCandidates()
+typedef struct FanCell {
+	uint16_t crossed;	// Last frame a ray crossed the cell
+	uint16_t queried;	// Last frame the sprites standing in it were collected
+} FanCell;
+// Rays never get further than DRAW_DISTANCE from the camera, so one square window of cells centred
+// on the camera covers everything a frame can stamp. Its size follows the draw distance and sprite
+// reach instead of the map, and moving the window needs no clearing since stamps are per frame.
+static FanCell *fanCells;
+static int fanRadius;		// Cells from the centre of the window to its edge
+static int fanOriginCol;	// Map cell of the window's top left corner this frame
+static int fanOriginRow;
+static uint16_t fanStamp;
+static Vector2 lastCastPosition;
+static float lastCastAngle;
 
 static unsigned int horizontal_fov;
 static unsigned int half_fov;
 static float vertical_fov;
 static unsigned int tile_size_pixels = VIEWPORT_HEIGHT / 10;
+// First cell shown in the top left of the automap
+static Vector2 automapOrigin;
 // Fisheye Correction Stuff
 static float projection_plane_width;
 static float projection_plane_half_width;
@@ -34,7 +137,15 @@ static float project_plane_height;
 static float height_ratio;
 static float half_wall_height;
 
-void CreateRenderer(bool fullscreen, bool vsync, unsigned int screenWidth, unsigned int screenHeight, unsigned int fov, unsigned int mapData[10][10])
+static void UpdateFieldOfView(unsigned int fov);
+static void LoadSoftwareTextures();
+static void LoadWallBatches();
+static void InvalidateAngleCache();
+static void OnMapChanged(const Map *changed, MapRegion region, void *data);
+static void FollowCameraWithMapWindow();
+static void UpdateMapWindowBuild();
+
+void CreateRenderer(bool fullscreen, bool vsync, unsigned int screenWidth, unsigned int screenHeight, unsigned int fov, const Map *mapData)
 {
 	UpdateRenderingSettings(fullscreen, vsync, screenWidth, screenHeight, fov);
 	UpdateRendererMapData(mapData);
@@ -49,19 +160,213 @@ void CreateRenderer(bool fullscreen, bool vsync, unsigned int screenWidth, unsig
 
 	renderer.column_pixel_width = 1;
 	renderer.ray_count = VIEWPORT_WIDTH;
+	UpdateProjection();
+	UpdateTraversalMode(traversalMode);
+	UpdateRenderCamera((Vector2) { 1.5, 1.5 }, 0.0);
+}
+
+/*
+ * Creates a renderer without a window or GL context. Everything is drawn by the software backend
+ * into renderer.framebuffer, read it back with GetSoftwareFramebuffer() after UpdateFrameBuffer().
+ */
+void CreateHeadlessRenderer(unsigned int fov, const Map *mapData)
+{
+	renderer.headless = true;
+	renderBackend = BACKEND_SOFTWARE;
+	gameMode = PLAYING;
+
+	UpdateFieldOfView(fov);
+	UpdateRendererMapData(mapData);
+
+	SearchAndSetResourceDir("resources");
+	LoadSoftwareTextures();
+
+	renderer.column_pixel_width = 1;
+	renderer.ray_count = VIEWPORT_WIDTH;
+	UpdateProjection();
+	UpdateTraversalMode(traversalMode);
 	UpdateRenderCamera((Vector2) { 1.5, 1.5 }, 0.0);
 }
 
-void UpdateRendererMapData(unsigned int mapData[10][10])
+/*
+ * Points the renderer at a new map. The map is read directly, not copied, so it has to stay loaded
+ * for as long as the renderer uses it. The renderer subscribes to the map and follows every
+ * CommitMapChanges() on its own, and unsubscribes from the map it used before. Edits that bypass
+ * the map's dirty tracking need this called again with the same map, which hands the whole window
+ * to the background job like a commit would, the occupancy pyramid is then only rebuilt around the
+ * cells that changed. Only a new map builds its window right away, there is no old one to draw.
+ */
+void UpdateRendererMapData(const Map *mapData)
+{
+	if (map != NULL && map != mapData) { UnsubscribeMap(map, OnMapChanged, NULL); }
+	SubscribeMap(mapData, OnMapChanged, NULL);
+
+	const MapRegion region = GetMapWindowRegion(mapData, renderer.cameraPosition, mapWindowRadius);
+	const Map *snapshot = &mapWindowBuilder.snapshot;
+	if (mapData == map && IsMapWindowReady(mapWindow) && IsSameMapRegion(mapWindow.region, region) &&
+		snapshot->width == map->width && snapshot->height == map->height)
+	{
+		QueueMapWindowChange(&mapWindowBuilder, (MapRegion){ 0, 0, map->width, map->height });
+		StartMapWindowBuild(&mapWindowBuilder, map, &mapWindow, region);
+		return;
+	}
+
+	map = mapData;
+	UnloadMapWindowBuilder(&mapWindowBuilder);
+	mapWindowBuilder = LoadMapWindowBuilder(map);
+	UnloadMapWindow(mapWindow);
+	mapWindow = LoadMapWindow(map, region);
+	InvalidateAngleCache();
+	frameDirty = true;
+
+	// Fit the whole map on the automap if the tiles stay big enough to see
+	tile_size_pixels = MAX(VIEWPORT_HEIGHT / MAX(map->width, map->height), MIN_AUTOMAP_TILE_SIZE);
+}
+
+/*
+ * Cheaper version of calling UpdateRendererMapData() again for when the edited cells are known.
+ */
+void UpdateRendererMapRegion(int col, int row, int width, int height)
+{
+	if (map == NULL) { return; }
+	QueueMapWindowChange(&mapWindowBuilder, (MapRegion){ col, row, width, height });
+	StartMapWindowBuild(&mapWindowBuilder, map, &mapWindow, GetMapWindowRegion(map, renderer.cameraPosition, mapWindowRadius));
+}
+
+/*
+ * Only keeps the renderer's copies of the map for the cells within radius of the camera, rounded
+ * out to whole map pages, so their memory no longer grows with the map. 0 copies the whole map,
+ * which is the default. Radii too small to hold everything in draw distance are raised to fit it.
+ * The window follows UpdateRenderCamera(), rebuilt on a background job whenever it moves.
+ */
+void UpdateRendererMapWindow(int radius)
+{
+	mapWindowRadius = radius > 0 ? MAX(radius, DRAW_DISTANCE + 1) : 0;
+	if (map != NULL) { UpdateRendererMapData(map); }
+}
+
+// Starts moving the map window once the camera has left the pages it covers
+static void FollowCameraWithMapWindow()
+{
+	if (map == NULL || mapWindowRadius == 0) { return; }
+	StartMapWindowBuild(&mapWindowBuilder, map, &mapWindow, GetMapWindowRegion(map, renderer.cameraPosition, mapWindowRadius));
+}
+
+/*
+ * Swaps in the map window the background job finished and starts the next one if commits or the
+ * camera left it out of date. Runs before every frame and never waits for the job: the frame is
+ * drawn from the last finished window, so edits show up a frame or two late, and when the camera
+ * gets ahead of the window the rays leaving it stop at its edge as if it were wall.
+ */
+static void UpdateMapWindowBuild()
+{
+	if (map == NULL) { return; }
+
+	if (FinishMapWindowBuild(&mapWindowBuilder, &mapWindow))
+	{
+		InvalidateAngleCache();
+		frameDirty = true;
+	}
+	StartMapWindowBuild(&mapWindowBuilder, map, &mapWindow, GetMapWindowRegion(map, renderer.cameraPosition, mapWindowRadius));
+}
+
+// Listener for map commits. Maps the renderer has moved on from may still call it, those are ignored.
+static void OnMapChanged(const Map *changed, MapRegion region, void *data)
+{
+	if (changed != map) { return; }
+	QueueMapWindowChange(&mapWindowBuilder, region);
+	StartMapWindowBuild(&mapWindowBuilder, map, &mapWindow, GetMapWindowRegion(map, renderer.cameraPosition, mapWindowRadius));
+}
+
+/*
+ * Distance field of the current map's window, stays valid (and up to date) across map changes and
+ * camera moves. Cells outside the window read as wall.
+ */
+const DistanceField *GetRendererDistanceField()
+{
+	return &mapWindow.distanceField;
+}
+
+/*
+ * One bit per cell copy of the walls of the current map's window, kept up to date the same way as
+ * the distance field.
+ */
+const OccupancyGrid *GetRendererOccupancy()
+{
+	return &mapWindow.occupancy.levels[0];
+}
+
+// Cells a sprite can reach into view from besides its own
+static int GetSpriteReach(const Sprite *sprite)
+{
+	return (int)ceilf(sprite->size / 2.0f);
+}
+
+/*
+ * Sets the sprites drawn with the 3D view. Like the map they aren't copied, the caller keeps them
+ * alive and calls this again after adding or removing any. Moving one only needs
+ * UpdateRendererSprite().
+ */
+void UpdateRendererSprites(const Sprite spriteData[], int count)
 {
-	// Copy over each value from new map data
-	for (int row = 0; row < 10; row++)
+	if (count > spriteCapacity)
 	{
-		for (int col = 0; col < 10; col++)
+		ProjectedSprite *visible = realloc(visibleSprites, count * sizeof(ProjectedSprite));
+		if (visible != NULL) { visibleSprites = visible; }
+		ProjectedSprite *scratch = realloc(spriteScratch, count * sizeof(ProjectedSprite));
+		if (scratch != NULL) { spriteScratch = scratch; }
+		Sprite *candidates = realloc(candidateSprites, count * sizeof(Sprite));
+		if (candidates != NULL) { candidateSprites = candidates; }
+		SpatialHash hash = LoadSpatialHash(count);
+		if (hash.capacity == count)
 		{
-			map[row][col] = mapData[row][col];
+			UnloadSpatialHash(spriteHash);
+			spriteHash = hash;
 		}
+		if (visible == NULL || scratch == NULL || candidates == NULL || hash.capacity != count)
+		{
+			TraceLog(LOG_WARNING, "RENDERER: Could not allocate room for %i sprites, drawing %i", count, spriteCapacity);
+			count = spriteCapacity;
+		}
+		else
+		{
+			spriteCapacity = count;
+		}
+	}
+	sprites = spriteData;
+	spriteCount = count;
+	ClearSpatialHash(&spriteHash);
+	spriteReach = 0;
+	for (int i = 0; i < count; i++)
+	{
+		InsertSpatialHash(&spriteHash, i, sprites[i].position);
+		spriteReach = MAX(spriteReach, GetSpriteReach(&sprites[i]));
+	}
+	frameDirty = true;
+}
+
+/*
+ * Cheaper version of calling UpdateRendererSprites() again for when only sprite index moved or
+ * changed, refiling it is O(1).
+ */
+void UpdateRendererSprite(int index)
+{
+	if (index < 0 || index >= spriteCount) { return; }
+	MoveSpatialHash(&spriteHash, index, sprites[index].position);
+	spriteReach = MAX(spriteReach, GetSpriteReach(&sprites[index]));
+	frameDirty = true;
+}
+
+/*
+ * Atlas index of a texture for Sprite.texture, -1 if it isn't one of the renderer's textures.
+ */
+int GetRendererTextureIndex(const char *fileName)
+{
+	for (int i = 0; i < (int)(sizeof(atlasTextureFiles) / sizeof(atlasTextureFiles[0])); i++)
+	{
+		if (strcmp(atlasTextureFiles[i], fileName) == 0) { return i; }
 	}
+	return -1;
 }
 
 void UpdateRenderingSettings(bool fullscreen, bool vsync, unsigned int screenWidth, unsigned int screenHeight, unsigned int fov)
@@ -87,7 +392,14 @@ void UpdateRenderingSettings(bool fullscreen, bool vsync, unsigned int screenWid
 	// Texture scale filter to use
 	SetTextureFilter(renderer.renderTex.texture, TEXTURE_FILTER_POINT);
 
-	// Calculate all render related constants
+	UpdateFieldOfView(fov);
+}
+
+/*
+ * Calculate all render related constants that depend on the FOV. Needs no window.
+ */
+static void UpdateFieldOfView(unsigned int fov)
+{
 	horizontal_fov = fov;
 	half_fov = horizontal_fov / 2;
 	vertical_fov = 2.0 * atanf(tanf(half_fov) * (float)(VIEWPORT_WIDTH / VIEWPORT_HEIGHT));
@@ -96,11 +408,28 @@ void UpdateRenderingSettings(bool fullscreen, bool vsync, unsigned int screenWid
 	height_ratio = ((float)VIEWPORT_HEIGHT / (float)VIEWPORT_WIDTH) / ((float)horizontal_fov / 90.0);
 	project_plane_height = (float)DRAW_DISTANCE * tanf(vertical_fov / 2.0);
 	half_wall_height = 5;
+	frameDirty = true;
+	UpdateProjection();
+}
+
+/*
+ * Rebuilds the projection table if the FOV or ray count no longer match the one in use.
+ */
+void UpdateProjection()
+{
+	if (renderer.ray_count == 0) { return; }
+	if (projection.castAngles != NULL && projection.rayCount == renderer.ray_count && projection.fov == horizontal_fov) { return; }
+
+	if (projection.castAngles != NULL) { UnloadProjectionTable(projection); }
+	projection = LoadProjectionTable(renderer.ray_count, horizontal_fov, VIEWPORT_WIDTH, DRAW_DISTANCE);
+	BuildFixedColumnAngles(fixedColumnAngles, renderer.ray_count, horizontal_fov, VIEWPORT_WIDTH);
+	frameDirty = true;
 }
 
 /*
  * Handles all input from keyboard.
- * TAB, R, T are used for debug functions such as switching draw modes, render resolution and shading.
+ * TAB, R, T, C, V, G, H, B are used for debug functions such as switching draw modes, render resolution, shading,
+ * ray traversal, coherent casting, the rotation cache, batched walls and render backend.
  */
 void RendererInput()
 {
@@ -158,33 +487,181 @@ void RendererInput()
 			break;
 		}
 	}
+	// Cycle through ray traversal modes (scalar/packet/fixed point/pyramid/sphere)
+	if (IsKeyPressed(KEY_C))
+	{
+		switch (traversalMode)
+		{
+		case DDA_SCALAR:
+			UpdateTraversalMode(DDA_PACKET);
+			break;
+		case DDA_PACKET:
+			UpdateTraversalMode(DDA_FIXED);
+			break;
+		case DDA_FIXED:
+			UpdateTraversalMode(DDA_PYRAMID);
+			break;
+		case DDA_PYRAMID:
+			UpdateTraversalMode(DDA_SPHERE);
+			break;
+		case DDA_SPHERE:
+			UpdateTraversalMode(DDA_SCALAR);
+			break;
+		}
+	}
+	// Toggle coherent ray casting
+	if (IsKeyPressed(KEY_V))
+	{
+		UpdateCoherentRays(!coherentRays);
+	}
+	// Toggle reusing wall hits while only turning
+	if (IsKeyPressed(KEY_G))
+	{
+		UpdateRotationCache(!rotationCache);
+	}
+	// Toggle drawing walls and sprites through the GL batches
+	if (IsKeyPressed(KEY_H))
+	{
+		UpdateBatchedWalls(!batchedWalls);
+	}
+	// Toggle between render backends (raylib/software)
+	if (IsKeyPressed(KEY_B))
+	{
+		switch (renderBackend)
+		{
+		case BACKEND_RAYLIB:
+			UpdateRenderBackend(BACKEND_SOFTWARE);
+			break;
+		case BACKEND_SOFTWARE:
+			UpdateRenderBackend(BACKEND_RAYLIB);
+			break;
+		}
+	}
 }
 
 void LoadTextures()
 {
-	renderer.textures[0] = LoadTexture("wabbit_alpha.png");
-	renderer.textures[1] = LoadTexture("checkerboard.png");
-	renderer.textures[2] = LoadTexture("checkerboard2.png");
-	renderer.textures[3] = LoadTexture("checkerboard64.png");
-	renderer.textures[4] = LoadTexture("grey_brick_32.png");
-	renderer.textures[5] = LoadTexture("red_brick.png");
-	renderer.textures[6] = LoadTexture("metal.png");
-	renderer.textures[7] = LoadTexture("tex_coords.png");
+	LoadSoftwareTextures();
+	UploadTextureAtlas(&renderer.wallAtlas);
+	if (batchedWalls) { LoadWallBatches(); }
+	frameDirty = true;
+
+	// Texture the software framebuffer gets uploaded into each frame
+	Image blank = GenImageColor(VIEWPORT_WIDTH, VIEWPORT_HEIGHT, BLACK);
+	renderer.framebufferTex = LoadTextureFromImage(blank);
+	UnloadImage(blank);
+	SetTextureFilter(renderer.framebufferTex, TEXTURE_FILTER_POINT);
+}
+
+// Needs a GL context, only loaded once batched walls are enabled
+static void LoadWallBatches()
+{
+	// Room for a quad per column at the highest quality
+	renderer.wallBatch = LoadWallBatch(VIEWPORT_WIDTH + 1);
+	renderer.spriteBatch = LoadWallBatch(SPRITE_BATCH_CAPACITY);
+}
+
+/*
+ * Packs the wall textures into renderer.wallAtlas and keeps a CPU copy of it and the framebuffer
+ * for the software backend. Only needs the image loader, not a GL context.
+ */
+static void LoadSoftwareTextures()
+{
+	renderer.wallAtlas = LoadTextureAtlas(atlasTextureFiles, sizeof(atlasTextureFiles) / sizeof(atlasTextureFiles[0]));
+	renderer.softwareWalls = LoadSoftwareTextureFromImage(renderer.wallAtlas.image);
+	BuildSurfaceTextures(&surfaceTextures, &renderer.wallAtlas, WALL_TEXTURE_COUNT, DEFAULT_FLOOR_TEXTURE, DEFAULT_CEILING_TEXTURE);
+	renderer.framebuffer = LoadSoftwareFramebuffer(VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
 }
 
 void UnloadTextures()
 {
-	// Unload render texture
-	UnloadRenderTexture(renderer.renderTex);
-	// Unload remaining textures
-	for (int i = 0; i < sizeof(renderer.textures) / sizeof(renderer.textures[0]); i++)
+	if (!renderer.headless)
 	{
-		UnloadTexture(renderer.textures[i]);
+		// Unload render texture
+		UnloadRenderTexture(renderer.renderTex);
+		UnloadTexture(renderer.framebufferTex);
+		UnloadWallBatch(renderer.wallBatch);
+		renderer.wallBatch = (WallBatch){ 0 };
+		UnloadWallBatch(renderer.spriteBatch);
+		renderer.spriteBatch = (WallBatch){ 0 };
 	}
+	// Unload wall textures, the atlas only has a GPU copy when there is a window
+	UnloadTextureAtlas(renderer.wallAtlas);
+	renderer.wallAtlas = (TextureAtlas){ 0 };
+	// Unload software backend
+	UnloadSoftwareTexture(renderer.softwareWalls);
+	renderer.softwareWalls = (SoftwareTexture){ 0 };
+	UnloadSoftwareFramebuffer(renderer.framebuffer);
+	// Unload projection table
+	UnloadProjectionTable(projection);
+	projection = (ProjectionTable){ 0 };
+	UnloadMapWindowBuilder(&mapWindowBuilder);
+	UnloadMapWindow(mapWindow);
+	mapWindow = (MapWindow){ 0 };
+	UnloadAngleCache(angleCache);
+	angleCache = (AngleCache){ 0 };
+	// Unload sprite buffers, the sprites themselves belong to the caller
+	free(visibleSprites);
+	free(spriteScratch);
+	free(candidateSprites);
+	visibleSprites = spriteScratch = NULL;
+	candidateSprites = NULL;
+	spriteCapacity = visibleSpriteCount = 0;
+	sprites = NULL;
+	spriteCount = 0;
+	UnloadSpatialHash(spriteHash);
+	spriteHash = (SpatialHash){ 0 };
+	free(fanCells);
+	fanCells = NULL;
+	fanRadius = 0;
+	// The map belongs to the caller and has to outlive this, only the subscription is dropped
+	if (map != NULL) { UnsubscribeMap(map, OnMapChanged, NULL); }
+	map = NULL;
 }
 
+/*
+ * Casts and rasterizes the frame on the CPU into renderer.framebuffer.
+ */
+static void UpdateSoftwareFrameBuffer()
+{
+	SoftwareClear(&renderer.framebuffer, BLACK);
+	if (gameMode != PLAYING) { return; }
+
+	DDANonLinear(rays, renderer.cameraPosition, renderer.cameraRotation);
+	if (drawMode == GAME || drawMode == GAME_DEBUG)
+	{
+		Draw3DSoftware(rays, &renderer.softwareWalls, &renderer.wallAtlas);
+	}
+	else if (drawMode == MAP || drawMode == MAP_DEBUG)
+	{
+		Draw2DSoftware(rays);
+	}
+}
+
+/*
+ * Casts and draws the frame into renderTex (or the software framebuffer). Frames where nothing
+ * changed since the last one are skipped and keep what is already there, except in the debug draw
+ * modes whose overlay changes every frame. Edits to the map only count once the renderer is told
+ * with UpdateRendererMapData()/UpdateRendererMapRegion(), anything else it can't see can force a
+ * redraw with MarkFrameDirty().
+ */
 void UpdateFrameBuffer()
 {
+	UpdateMapWindowBuild();
+	if (!renderer.headless && IsWindowResized()) { frameDirty = true; }
+	const bool redraw = frameDirty || drawMode == GAME_DEBUG || drawMode == MAP_DEBUG;
+	frameDirty = false;
+
+	if (renderBackend == BACKEND_SOFTWARE)
+	{
+		if (redraw)
+		{
+			UpdateSoftwareFrameBuffer();
+			if (!renderer.headless) { UpdateTexture(renderer.framebufferTex, renderer.framebuffer.pixels); }
+		}
+		if (renderer.headless) { return; }
+	}
+
 	// Compute required framebuffer scaling
 	renderer.renderScale = MIN((float)GetScreenWidth() / VIEWPORT_WIDTH, (float)GetScreenHeight() / VIEWPORT_HEIGHT);
 
@@ -198,6 +675,9 @@ void UpdateFrameBuffer()
 		(Vector2) { (float)VIEWPORT_WIDTH, (float)VIEWPORT_HEIGHT }
 	);
 
+	// renderTex still holds the last frame
+	if (!redraw) { return; }
+
 	// Draw everything in the render texture, note this will not be rendered on screen, yet
 	BeginTextureMode(renderer.renderTex);
 		// Setup the backbuffer for drawing (clear color and depth buffers)
@@ -210,14 +690,22 @@ void UpdateFrameBuffer()
 		case SETTINGS:
 			break;
 		case PLAYING:
-			DDANonLinear(rays, renderer.cameraPosition, renderer.cameraRotation);
-			if (drawMode == GAME || drawMode == GAME_DEBUG)
+			if (renderBackend == BACKEND_SOFTWARE)
 			{
-				Draw3D(rays, renderer.textures[3]);
+				// Already rasterized and uploaded above
+				DrawTexture(renderer.framebufferTex, 0, 0, WHITE);
 			}
-			else if (drawMode == MAP || drawMode == MAP_DEBUG)
+			else
 			{
-				Draw2D(rays);
+				DDANonLinear(rays, renderer.cameraPosition, renderer.cameraRotation);
+				if (drawMode == GAME || drawMode == GAME_DEBUG)
+				{
+					Draw3D(rays, &renderer.wallAtlas);
+				}
+				else if (drawMode == MAP || drawMode == MAP_DEBUG)
+				{
+					Draw2D(rays);
+				}
 			}
 			if (drawMode == GAME_DEBUG || drawMode == MAP_DEBUG) { DrawDebug(); }
 			break;
@@ -235,6 +723,8 @@ void UpdateFrameBuffer()
 
 void UpdateScreen()
 {
+	if (renderer.headless) { return; }
+
 	BeginDrawing();
 		// Clear screen background
 		ClearBackground(BLACK);
@@ -268,18 +758,26 @@ void UpdateScreen()
 
 void UpdateRenderCamera(Vector2 position, float rotation)
 {
+	if (position.x != renderer.cameraPosition.x || position.y != renderer.cameraPosition.y || rotation != renderer.cameraRotation)
+	{
+		frameDirty = true;
+	}
 	renderer.cameraPosition = position;
 	renderer.cameraRotation = rotation;
 	renderer.cameraForward = Vector2Forward(rotation);
+	FollowCameraWithMapWindow();
 }
 
-void UpdateDrawMode(DrawMode newDrawMode) { drawMode = newDrawMode; }
+void UpdateDrawMode(DrawMode newDrawMode) { drawMode = newDrawMode; frameDirty = true; }
+
+void UpdateShadingMode(ShadingMode newShadingMode) { shadingMode = newShadingMode; frameDirty = true; }
 
-void UpdateShadingMode(ShadingMode newShadingMode) { shadingMode = newShadingMode; }
+void MarkFrameDirty() { frameDirty = true; }
 
 void UpdateRenderQuality(RenderQuality newRenderQuality)
 {
 	renderQuality = newRenderQuality;
+	frameDirty = true;
 	switch (renderQuality)
 	{
 	case VERY_LOW:
@@ -300,6 +798,78 @@ void UpdateRenderQuality(RenderQuality newRenderQuality)
 		break;
 	}
 	renderer.ray_count = VIEWPORT_WIDTH / renderer.column_pixel_width;
+	UpdateProjection();
+}
+
+void UpdateRenderBackend(RenderBackend newRenderBackend)
+{
+	// Without a window there is nothing for raylib to draw into
+	renderBackend = renderer.headless ? BACKEND_SOFTWARE : newRenderBackend;
+	frameDirty = true;
+}
+
+const SoftwareFramebuffer *GetSoftwareFramebuffer() { return &renderer.framebuffer; }
+
+unsigned int GetRayCount() { return renderer.ray_count; }
+
+void UpdateTraversalMode(TraversalMode newTraversalMode)
+{
+	traversalMode = newTraversalMode;
+	// Packets need SSE or AVX2, fall back to one ray at a time on anything else
+	if (traversalMode == DDA_PACKET && GetRayPacketWidth() == PACKET_SCALAR)
+	{
+		traversalMode = DDA_SCALAR;
+	}
+}
+
+/*
+ * Coherent casting works on top of any traversal mode, see CastRaySpan().
+ */
+void UpdateCoherentRays(bool enabled)
+{
+	coherentRays = enabled;
+}
+
+/*
+ * While the camera only turns DDANonLinear() takes wall hits from a cache of directions around the
+ * camera position instead of casting, see CastRaysFromAngleCache(). The cache is allocated the
+ * first time it is enabled.
+ */
+void UpdateRotationCache(bool enabled)
+{
+	rotationCache = enabled;
+	if (rotationCache && angleCache.cast == NULL)
+	{
+		angleCache = LoadAngleCache();
+		ResetAngleCache(&angleCache, lastCastPosition);
+	}
+}
+
+/*
+ * Draws walls and sprites through the GL batches, merging columns into segments, see
+ * DrawWallRuns(). Falls back to drawing per column while the batches can't be loaded or in
+ * headless mode. Off by default, the batch shaders and buffers haven't been verified on real GL 3.3
+ * and ES2 contexts yet. The batches are loaded the first time it is enabled with a window open.
+ */
+void UpdateBatchedWalls(bool enabled)
+{
+	batchedWalls = enabled;
+	if (batchedWalls && !renderer.headless && IsWindowReady() && !IsWallBatchReady(renderer.wallBatch))
+	{
+		UnloadWallBatch(renderer.wallBatch);
+		UnloadWallBatch(renderer.spriteBatch);
+		LoadWallBatches();
+	}
+	frameDirty = true;
+}
+
+// Cached hits are only valid for the map they were cast against
+static void InvalidateAngleCache()
+{
+	if (angleCache.cast != NULL)
+	{
+		ResetAngleCache(&angleCache, angleCache.position);
+	}
 }
 
 /*
@@ -366,8 +936,10 @@ void DDA(struct RayData rays[], Vector2 position, float angle)
 		bool hitWall = false;
 		bool hitX = false;
 		float distanceChecked = 0.0f;
+		int steps = 0;
 		while (!hitWall && distanceChecked < DRAW_DISTANCE)
 		{
+			steps++;
 			// Step along shortest length
 			if (rayLength.x < rayLength.y)
 			{
@@ -384,11 +956,12 @@ void DDA(struct RayData rays[], Vector2 position, float angle)
 				hitX = false;
 			}
 
-			hitWall = map[mapRow][mapCol] == 1;
+			hitWall = IsMapWall(map, mapCol, mapRow);
 		}
 
 		// Save for rendering shadowed walls
 		rays[i].hitX = hitX;
+		rays[i].steps = steps;
 		if (hitX)
 		{
 			rays[i].distance = rayLength.x - step.x;
@@ -482,7 +1055,7 @@ void DDASingle(Vector2 position, float angle)
 		ray.end = Vector2Add(ray.end, Vector2Scale(forward, distanceChecked));
 		DrawCircle(ray.end.x * tile_size_pixels, ray.end.y * tile_size_pixels, 5.0f, PURPLE);
 
-		hitWall = map[mapRow][mapCol] == 1;
+		hitWall = IsMapWall(map, mapCol, mapRow);
 	}
 
 	ray.end = (Vector2){ position.x, position.y };
@@ -512,35 +1085,21 @@ void DDASingle(Vector2 position, float angle)
 }
 
 /*
- * DDA using a non-linear angle step for casting each ray. The math for calculating the angles and
- * distance can be found at https://www.scottsmitelli.com/articles/we-can-fix-your-raycaster/.
+ * Scalar traversal used by DDANonLinear(). Casts rays[first] to rays[first + count - 1] one at a
+ * time using the directions already stored in rayForward[]. Walls are read from the occupancy
+ * bitmap rather than the map itself.
  */
-void DDANonLinear(struct RayData rays[], Vector2 position, float angle)
+static void CastRaysScalar(struct RayData rays[], int first, int count, Vector2 position)
 {
-	const unsigned int xPixelWidth = VIEWPORT_WIDTH / renderer.ray_count;
-	const unsigned int half_ray_count = renderer.ray_count / 2;
-
-	// Calculate angles
-	for (int i = 0; i <= half_ray_count; i++)
-	{
-		float xScreen = i * xPixelWidth;
-		float X_PROJECTION_PLANE = (((float)(xScreen * 2) - X_MAX) / X_MAX) * (projection_plane_half_width);
-		float castAngle = atan2f(X_PROJECTION_PLANE, DRAW_DISTANCE);
-
-		rays[i].castAngleRadians = castAngle;
-		rays[renderer.ray_count - i].castAngleRadians = -castAngle;
-	}
-
-	// Cast the rays
-	for (int i = 0; i <= renderer.ray_count; i++)
+	for (int i = first; i < first + count; i++)
 	{
 		rays[i].start = position;
 
-		float angle = (rays[i].castAngleRadians * RAD2DEG) + renderer.cameraRotation;
-		Vector2 forward = Vector2Forward(angle);
+		Vector2 forward = rayForward[i];
+		// forward is a unit vector so sqrt[1^2 + (dy/dx)^2] is just 1 / |dx|
 		Vector2 step = (Vector2){
-			sqrtf(1 + ((forward.y / forward.x) * (forward.y / forward.x))),
-			sqrtf(1 + ((forward.x / forward.y) * (forward.x / forward.y)))
+			fabsf(1.0f / forward.x),
+			fabsf(1.0f / forward.y)
 		};
 
 		// Convert pixel coords into map grid coords
@@ -575,8 +1134,10 @@ void DDANonLinear(struct RayData rays[], Vector2 position, float angle)
 		bool hitWall = false;
 		bool hitX = false;
 		float distanceChecked = 0.0f;
+		int steps = 0;
 		while (!hitWall && distanceChecked < DRAW_DISTANCE)
 		{
+			steps++;
 			// Step along shortest length
 			if (rayLength.x < rayLength.y)
 			{
@@ -593,7 +1154,7 @@ void DDANonLinear(struct RayData rays[], Vector2 position, float angle)
 				hitX = false;
 			}
 
-			hitWall = map[mapRow][mapCol] == 1;
+			hitWall = IsCellOccupied(&mapWindow.occupancy.levels[0], mapCol, mapRow);
 		}
 
 
@@ -601,20 +1162,256 @@ void DDANonLinear(struct RayData rays[], Vector2 position, float angle)
 
 		// Save for rendering shadowed walls
 		rays[i].hitX = hitX;
+		rays[i].steps = steps;
 		// Choose which distance and offset value to store based on if we hit horizontal or vertical wall
 		if (hitX)	// Horizontal wall hit
 		{
-			rays[i].distance = (rayLength.x - step.x) * cosf(rays[i].castAngleRadians);
+			rays[i].distance = (rayLength.x - step.x) * projection.corrections[i];
 			rays[i].offset = fmod(rays[i].end.y, 1.0f);
 		}
 		else       // Vertical wall hit
 		{
-			rays[i].distance = (rayLength.y - step.y) * cosf(rays[i].castAngleRadians);
+			rays[i].distance = (rayLength.y - step.y) * projection.corrections[i];
 			rays[i].offset = fmod(rays[i].end.x, 1.0f);
 		};
 	}
 }
 
+typedef struct RayCastJob {
+	struct RayData *rays;
+	Vector2 position;
+	float angle;
+	bool angleCached;	// angleCache holds every direction in view from position
+} RayCastJob;
+
+/*
+ * Casts rays[first] to rays[first + count - 1] with the current traversal mode.
+ */
+static void CastRays(const RayCastJob *job, int first, int count)
+{
+	if (traversalMode == DDA_FIXED)
+	{
+		CastRaysFixed(job->rays, fixedColumnAngles, first, count, job->position, job->angle, &mapWindow.occupancy.levels[0], DRAW_DISTANCE);
+	}
+	else if (traversalMode == DDA_PYRAMID)
+	{
+		CastRaysPyramid(job->rays, rayForward, projection.corrections, first, count, job->position, &mapWindow.occupancy, DRAW_DISTANCE);
+	}
+	else if (traversalMode == DDA_SPHERE)
+	{
+		CastRaysSphere(job->rays, rayForward, projection.corrections, first, count, job->position, &mapWindow.distanceField, &mapWindow.occupancy.levels[0], DRAW_DISTANCE);
+	}
+	else if (traversalMode != DDA_PACKET ||
+		!CastRayPackets(job->rays, rayForward, projection.corrections, first, count, job->position, &mapWindow.occupancy.levels[0], DRAW_DISTANCE))
+	{
+		CastRaysScalar(job->rays, first, count, job->position);
+	}
+}
+
+/*
+ * Finds the wall cell a cast ray stopped in. Returns false if the ray ran out of draw distance
+ * instead of hitting a wall.
+ */
+static bool GetRayHitCell(const struct RayData *ray, int *col, int *row)
+{
+	const OccupancyGrid *cells = &mapWindow.occupancy.levels[0];
+	if (ray->hitX)
+	{
+		// Stopped on a vertical grid line, the wall is on the side the ray was moving towards
+		*col = (int)roundf(ray->end.x) - (ray->end.x < ray->start.x ? 1 : 0);
+		*row = (int)floorf(ray->end.y);
+		// Rays through a grid corner may have already moved on to the row above
+		if (ray->end.y == (float)*row && !IsCellOccupied(cells, *col, *row)) { *row -= 1; }
+	}
+	else
+	{
+		*col = (int)floorf(ray->end.x);
+		*row = (int)roundf(ray->end.y) - (ray->end.y < ray->start.y ? 1 : 0);
+		if (ray->end.x == (float)*col && !IsCellOccupied(cells, *col, *row)) { *col -= 1; }
+	}
+	return IsCellOccupied(cells, *col, *row);
+}
+
+// Grid line of the face of wall cell col, row that can be seen from position
+static float GetWallFaceLine(Vector2 position, bool hitX, int col, int row)
+{
+	return hitX ?
+		(float)col + (position.x > (float)col ? 1.0f : 0.0f) :
+		(float)row + (position.y > (float)row ? 1.0f : 0.0f);
+}
+
+/*
+ * Fills in rays[i] without traversing, from the grid line of the wall face it is known to hit.
+ * Cell col, row is the wall the face belongs to.
+ */
+static void InterpolateRay(const RayCastJob *job, int i, bool hitX, float line, int col, int row)
+{
+	struct RayData *ray = &job->rays[i];
+	const Vector2 forward = rayForward[i];
+	const float length = hitX ? (line - job->position.x) / forward.x : (line - job->position.y) / forward.y;
+
+	ray->start = job->position;
+	ray->end = Vector2Add(job->position, Vector2Scale(forward, length));
+	ray->hitX = hitX;
+	ray->distance = length * projection.corrections[i];
+	ray->offset = hitX ? ray->end.y - (float)row : ray->end.x - (float)col;
+	ray->steps = 0;
+}
+
+/*
+ * Rays left and right are already cast. When both hit the same face of the same wall cell every
+ * ray between them hits that face too, so those are interpolated from the face's grid line. If not
+ * the middle ray is cast and both halves are tried again, which only ends up casting every ray
+ * where the hits keep changing from column to column.
+ */
+static void CastRaySpan(const RayCastJob *job, int left, int right)
+{
+	if (right - left < 2) { return; }
+
+	const struct RayData *leftRay = &job->rays[left];
+	const struct RayData *rightRay = &job->rays[right];
+	int leftCol, leftRow, rightCol, rightRow;
+	if (leftRay->hitX == rightRay->hitX &&
+		GetRayHitCell(leftRay, &leftCol, &leftRow) &&
+		GetRayHitCell(rightRay, &rightCol, &rightRow) &&
+		leftCol == rightCol && leftRow == rightRow)
+	{
+		const float line = GetWallFaceLine(job->position, leftRay->hitX, leftCol, leftRow);
+		for (int i = left + 1; i < right; i++)
+		{
+			InterpolateRay(job, i, leftRay->hitX, line, leftCol, leftRow);
+		}
+		return;
+	}
+
+	const int middle = (left + right) / 2;
+	CastRays(job, middle, 1);
+	CastRaySpan(job, left, middle);
+	CastRaySpan(job, middle, right);
+}
+
+/*
+ * Each column lies between two cached directions. If both of them hit the same face of the same
+ * wall cell so does the column, which is then interpolated from that face. The rest, mostly the
+ * columns at the edges of walls, are cast in runs with the current traversal mode.
+ */
+static void CastRaysFromAngleCache(const RayCastJob *job, int first, int count)
+{
+	const float angle = job->angle * DEG2RAD;
+	int uncached = first;	// Start of the run of columns waiting to be cast
+	for (int i = first; i < first + count; i++)
+	{
+		const int sample = GetAngleCacheIndex(angle + projection.castAngles[i]);
+		const AngleCacheHit *low = &angleCache.hits[sample];
+		const AngleCacheHit *high = &angleCache.hits[(sample + 1) % ANGLE_CACHE_SIZE];
+		if (low->hit && high->hit && low->hitX == high->hitX && low->col == high->col && low->row == high->row)
+		{
+			if (i > uncached) { CastRays(job, uncached, i - uncached); }
+			InterpolateRay(job, i, low->hitX, GetWallFaceLine(job->position, low->hitX, low->col, low->row), low->col, low->row);
+			uncached = i + 1;
+		}
+	}
+	if (first + count > uncached) { CastRays(job, uncached, first + count - uncached); }
+}
+
+// Job casting the not yet cached directions from *data on
+static void FillAngleCacheChunk(void *data, int first, int count)
+{
+	const int *firstSample = data;
+	FillAngleCache(&angleCache, *firstSample + first, count, &mapWindow.occupancy.levels[0], DRAW_DISTANCE);
+}
+
+/*
+ * Looks up the map cell each ray stopped at so the wall can be drawn with its texture. Done once
+ * after casting instead of in every traversal mode.
+ */
+static void StoreRayCells(const RayCastJob *job, int first, int count)
+{
+	for (int i = first; i < first + count; i++)
+	{
+		struct RayData *ray = &job->rays[i];
+		int col, row;
+		ray->cell = GetRayHitCell(ray, &col, &row) ? GetMapCell(map, col, row) : CELL_EMPTY;
+	}
+}
+
+/*
+ * Job run by the worker threads, casts one chunk of rays. Each ray only writes its own RayData so
+ * chunks never touch the same memory. With coherent casting only every COHERENT_RAY_SPACING'th ray
+ * (and the last one) is cast up front, CastRaySpan() takes care of the rest.
+ */
+static void CastRayChunk(void *data, int first, int count)
+{
+	const RayCastJob *job = data;
+	if (job->angleCached)
+	{
+		CastRaysFromAngleCache(job, first, count);
+	}
+	else if (!coherentRays)
+	{
+		CastRays(job, first, count);
+	}
+	else
+	{
+		const int last = first + count - 1;
+		for (int i = first; i < last; i += COHERENT_RAY_SPACING)
+		{
+			CastRays(job, i, 1);
+		}
+		CastRays(job, last, 1);
+
+		for (int left = first; left < last; left += COHERENT_RAY_SPACING)
+		{
+			CastRaySpan(job, left, MIN(left + COHERENT_RAY_SPACING, last));
+		}
+	}
+	StoreRayCells(job, first, count);
+}
+
+/*
+ * DDA using a non-linear angle step for casting each ray. The math for calculating the angles and
+ * distance can be found at https://www.scottsmitelli.com/articles/we-can-fix-your-raycaster/.
+ * The angles are precomputed per configuration in the projection table. In DDA_PACKET mode adjacent
+ * rays are traversed together with SSE/AVX2, see ray_packet.c. DDA_FIXED uses the integer only
+ * traversal from fixed_dda.c instead. DDA_PYRAMID jumps across open blocks of the occupancy
+ * pyramid (pyramid_dda.c) and DDA_SPHERE across the open squares of the distance field
+ * (sphere_dda.c). The rays are split into chunks and cast in parallel by the job system. With
+ * coherent casting enabled runs of columns that hit the same wall face are interpolated instead,
+ * with the rotation cache so are columns between cached directions that hit the same face.
+ */
+void DDANonLinear(struct RayData rays[], Vector2 position, float angle)
+{
+	// Angles and camera relative directions come from the projection table, only the camera
+	// rotation has to be applied each frame
+	for (int i = 0; i <= renderer.ray_count; i++)
+	{
+		rays[i].castAngleRadians = projection.castAngles[i];
+	}
+	RotateProjectionTable(&projection, angle, rayForward);
+
+	// Turning on the spot sees the same walls, make sure every direction in view is cached first.
+	// Moving would invalidate the cache every frame so it is left alone until the camera stops.
+	const CameraMotion motion = ClassifyCameraMotion(lastCastPosition, lastCastAngle, position, angle);
+	lastCastPosition = position;
+	lastCastAngle = angle;
+	const bool angleCached = rotationCache && motion != CAMERA_MOVING;
+	if (angleCached)
+	{
+		if (angleCache.position.x != position.x || angleCache.position.y != position.y)
+		{
+			ResetAngleCache(&angleCache, position);
+		}
+		const int firstSample = GetAngleCacheIndex(angle * DEG2RAD + projection.castAngles[0]);
+		const int lastSample = GetAngleCacheIndex(angle * DEG2RAD + projection.castAngles[renderer.ray_count]) + 1;
+		const int sampleCount = ((lastSample - firstSample) & (ANGLE_CACHE_SIZE - 1)) + 1;
+		RunParallelFor(FillAngleCacheChunk, (void *)&firstSample, sampleCount, RAY_CHUNK_SIZE);
+	}
+
+	// Cast the rays
+	RayCastJob job = { rays, position, angle, angleCached };
+	RunParallelFor(CastRayChunk, &job, renderer.ray_count + 1, RAY_CHUNK_SIZE);
+}
+
 /*
  * DDA using a non-linear angle step for casting each ray. The math for calculating the angles and
  * distance can be found at https://www.scottsmitelli.com/articles/we-can-fix-your-raycaster/.
@@ -628,160 +1425,714 @@ void DrawDebug()
 	DrawText(TextFormat("Render Quality: %d", renderQuality), 0, 60, 20, WHITE);
 	DrawText(TextFormat("Scale: %f", renderer.renderScale), 0, 80, 20, WHITE);
 	DrawText(TextFormat("Screen: ( %d , %d )", GetScreenWidth(), GetScreenHeight()), 0, 100, 20, WHITE);
+	DrawText(TextFormat("Traversal: %d (packet width %d, coherent %d, rotation cache %d, batched walls %d)", traversalMode, GetRayPacketWidth(), coherentRays, rotationCache, batchedWalls), 0, 120, 20, WHITE);
+	DrawText(TextFormat("Backend: %d", renderBackend), 0, 140, 20, WHITE);
 	//DrawText(TextFormat("Render: ( %d , %d )", GetRenderWidth(), GetRenderHeight()), 0, 140, 20, WHITE);
 	//DrawText(TextFormat("Player Position: ( %f , %f )", player.position.x, player.position.y), 0, 40, 20, WHITE);
 	//DrawText(TextFormat("Player Rotation: %f", player.rotation), 0, 60, 20, WHITE);
 	//DrawText(TextFormat("Player Forward: ( %f , %f )", forward.x, forward.y), 0, 80, 20, WHITE);
 }
 
+/*
+ * Picks which cells the automap shows. Maps that fit are drawn whole from the top left, larger ones
+ * keep the camera in the middle of the viewport without scrolling past the map edges.
+ */
+static void UpdateAutomapView(int *firstCol, int *firstRow, int *lastCol, int *lastRow)
+{
+	const int visibleCols = VIEWPORT_WIDTH / tile_size_pixels + 1;
+	const int visibleRows = VIEWPORT_HEIGHT / tile_size_pixels + 1;
+
+	*firstCol = MIN(MAX((int)renderer.cameraPosition.x - (visibleCols / 2), 0), MAX(map->width - visibleCols, 0));
+	*firstRow = MIN(MAX((int)renderer.cameraPosition.y - (visibleRows / 2), 0), MAX(map->height - visibleRows, 0));
+	*lastCol = MIN(*firstCol + visibleCols, map->width) - 1;
+	*lastRow = MIN(*firstRow + visibleRows, map->height) - 1;
+	automapOrigin = (Vector2){ (float)*firstCol, (float)*firstRow };
+}
+
+// Map coordinates to automap pixel coordinates
+static Vector2 MapToAutomap(Vector2 point)
+{
+	return Vector2Scale(Vector2Subtract(point, automapOrigin), (float)tile_size_pixels);
+}
+
 /*
  * Draws the 2D version of the map. Usefule as a type of "automap" and useful for debugging.
  */
 void Draw2D(const struct RayData rays[])
 {
+	int firstCol, firstRow, lastCol, lastRow;
+	UpdateAutomapView(&firstCol, &firstRow, &lastCol, &lastRow);
+
 	// Draw Map
-	for (int row = 0; row < 10; row++)
+	for (int row = firstRow; row <= lastRow; row++)
 	{
-		for (int col = 0; col < 10; col++)
+		for (int col = firstCol; col <= lastCol; col++)
 		{
-			if (map[row][col] == 1)
+			Vector2 tile = MapToAutomap((Vector2){ (float)col, (float)row });
+			if (IsMapWall(map, col, row))
 			{
 				// Walls
-				DrawRectangle(tile_size_pixels * col, tile_size_pixels * row, tile_size_pixels - 2, tile_size_pixels - 2, RED);
+				DrawRectangle(tile.x, tile.y, tile_size_pixels - 2, tile_size_pixels - 2, RED);
 			}
 			else
 			{
 				// Open Space
-				DrawRectangle(tile_size_pixels * col, tile_size_pixels * row, tile_size_pixels - 2, tile_size_pixels - 2, BLUE);
+				DrawRectangle(tile.x, tile.y, tile_size_pixels - 2, tile_size_pixels - 2, BLUE);
 			}
 		}
 	}
 
 	for (int i = 0; i <= renderer.ray_count; i++)
 	{
+		Vector2 start = MapToAutomap(rays[i].start);
+		Vector2 end = MapToAutomap(rays[i].end);
 		if (i >= (renderer.ray_count / 2) - 3 && i <= (renderer.ray_count / 2) + 3)
 		{
-			DrawLine(
-				rays[i].start.x * tile_size_pixels,
-				rays[i].start.y * tile_size_pixels,
-				rays[i].end.x * tile_size_pixels,
-				rays[i].end.y * tile_size_pixels,
-				YELLOW
-			);
+			DrawLine(start.x, start.y, end.x, end.y, YELLOW);
 		}
 		else {
-			DrawLine(
-				rays[i].start.x * tile_size_pixels,
-				rays[i].start.y * tile_size_pixels,
-				rays[i].end.x * tile_size_pixels,
-				rays[i].end.y * tile_size_pixels,
-				PURPLE
-			);
+			DrawLine(start.x, start.y, end.x, end.y, PURPLE);
 		}
 	}
 
 	// Draw Player
-	DrawCircle(renderer.cameraPosition.x * tile_size_pixels, renderer.cameraPosition.y * tile_size_pixels, 0.2 * tile_size_pixels, GREEN);
+	Vector2 camera = MapToAutomap(renderer.cameraPosition);
+	DrawCircle(camera.x, camera.y, 0.2 * tile_size_pixels, GREEN);
 	Vector2 temp = renderer.cameraForward;
 	temp = Vector2Scale(temp, 25.0f);
-	temp = Vector2Add(temp, Vector2Scale(renderer.cameraPosition, tile_size_pixels));
-	DrawLine(renderer.cameraPosition.x * tile_size_pixels, renderer.cameraPosition.y * tile_size_pixels, temp.x, temp.y, GREEN);
+	temp = Vector2Add(temp, camera);
+	DrawLine(camera.x, camera.y, temp.x, temp.y, GREEN);
+}
+
+typedef struct WallColumn {
+	float top;
+	float height;
+	float texStart;
+	float texSpan;
+	Color tint;
+} WallColumn;
+
+// How brightly a wall distance away is lit
+static Color GetWallTint(bool hitX, float distance)
+{
+	Color wallColor = DARKGRAY;
+	// Shade walls darker if they are perpedicular
+	if (hitX) {
+		wallColor = WHITE;
+	}
+	// Scale for brightness
+	float brightness = LIGHT_RANGE / distance;
+	if (brightness > 1.0f) { brightness = 1.0f; }
+	wallColor.r *= brightness;
+	wallColor.g *= brightness;
+	wallColor.b *= brightness;
+	return wallColor;
 }
 
 /*
- * Draws the 3D version of the map. Takes an array of rays that have been filled by DDANonLinear().
- * Also takes in a texture to draw on the walls. Will update this later to look at map data for
- * the texture to use instead of a single texture. Draws Ceiling and Floor first.  Next goes
- * through the ray data and draws each column at a fixed width and adjsuts the height based on
- * distance from the Player.
+ * Works out where a ray's wall column lands on screen, which rows of a texture texHeight texels
+ * tall it shows and how brightly it is lit. Shared by both render backends.
  */
-void Draw3D(struct RayData rays[], Texture2D tex)
+static WallColumn ComputeWallColumn(const struct RayData *ray, float texHeight)
+{
+	WallColumn column;
+	// Calculate the height based on distance from camera
+	float height = (VIEWPORT_HEIGHT * height_ratio) / ray->distance;
+	float heightPercent = 1.0f;
+
+	float texOffset = texHeight;
+	float texStartOffset = 0.0f;
+	// Clamp the height so we don't draw outside of the viewport
+	if (height > VIEWPORT_HEIGHT) {
+		heightPercent = height / VIEWPORT_HEIGHT;
+
+		texStartOffset = 1.0f / heightPercent;
+		texOffset *= texStartOffset;
+		texStartOffset = ((1.0f - texStartOffset) / 2.0f) * texHeight;
+
+		// Keep height from exceeding height of viewport
+		height /= heightPercent;
+	}
+
+	column.top = (VIEWPORT_HEIGHT / 2) - (height / 2);
+	column.height = height;
+	column.texStart = texStartOffset;
+	column.texSpan = texOffset;
+	column.tint = GetWallTint(ray->hitX, ray->distance);
+	return column;
+}
+
+/*
+ * Where the texture of the wall a ray hit is in the atlas. Cell values past the last wall texture
+ * wrap back around to the first.
+ */
+static Rectangle GetWallTextureRect(const TextureAtlas *atlas, MapCell cell)
+{
+	if (atlas->count == 0) { return (Rectangle){ 0 }; }
+	return GetAtlasRect(atlas, cell >= CELL_WALL ? (cell - CELL_WALL) % MIN(atlas->count, WALL_TEXTURE_COUNT) : 0);
+}
+
+static Color FlatWallColor(const struct RayData *ray)
+{
+	Color wallColor = RED;
+	// Shade walls darker if they are perpedicular
+	if (!ray->hitX) {
+		wallColor.r *= 0.5f;
+		wallColor.g *= 0.5f;
+		wallColor.b *= 0.5f;
+	}
+	return wallColor;
+}
+
+typedef struct FloorCastJob {
+	SoftwareFramebuffer *target;
+	FloorView view;
+} FloorCastJob;
+
+// Job casting a chunk of floor and ceiling row pairs
+static void CastFloorChunk(void *data, int first, int count)
+{
+	const FloorCastJob *job = data;
+	CastFloorRows(job->target, &job->view, &mapWindow.surfaces, &surfaceTextures, &renderer.softwareWalls, first, count);
+}
+
+/*
+ * Textures the floor and ceiling of target from the camera, see floor_cast.c. Uses the same
+ * projection as the rays so the floor meets the walls, one texel across per column. The row pairs
+ * are cast in parallel by the job system.
+ */
+static void CastFloorAndCeiling(SoftwareFramebuffer *target)
+{
+	const float tanHalfFov = tanf(DEG2RAD * half_fov);
+	const Vector2 forward = renderer.cameraForward;
+	const Vector2 across = { -forward.y, forward.x };
+	FloorCastJob job = { target };
+	job.view.position = renderer.cameraPosition;
+	job.view.rayStart = Vector2Subtract(forward, Vector2Scale(across, tanHalfFov));
+	job.view.rayStep = Vector2Scale(across, (2.0f * renderer.column_pixel_width * tanHalfFov) / X_MAX);
+	job.view.rowScale = (VIEWPORT_HEIGHT * height_ratio) / 2.0f;
+	job.view.lightRange = LIGHT_RANGE;
+	job.view.blockWidth = renderer.column_pixel_width;
+	RunParallelFor(CastFloorChunk, &job, target->height / 2, FLOOR_ROW_CHUNK_SIZE);
+}
+
+/*
+ * Adds rays first to last, which all hit the same face of the same wall cell, to renderer.wallBatch
+ * as one segment. Wall height, 1 / distance and texture x * 1 / distance all change linearly across
+ * the screen on a flat wall, so the segment's right edge one column past the last ray is
+ * extrapolated from the run and the batch's shader fills in everything between perspective correct.
+ * Single rays become a flat column like before.
+ */
+static void AddWallRun(const struct RayData rays[], int first, int last, const TextureAtlas *atlas)
 {
 	const float widthPercent = (float)renderer.column_pixel_width / (float)VIEWPORT_WIDTH;
-	// Draw Ceiling
-	DrawRectangle(0, 0, VIEWPORT_WIDTH, VIEWPORT_HEIGHT / 2, LIGHTGRAY);
-	// Draw Floor
-	DrawRectangle(0, VIEWPORT_HEIGHT / 2, VIEWPORT_WIDTH, VIEWPORT_HEIGHT / 2, DARKGRAY);
-	// Walls
-	for (int i = 0; i <= renderer.ray_count; i++)
+	const float qLast = 1.0f / rays[last].distance;
+	WallEdge left = { (float)(first * renderer.column_pixel_width), 0.0f, 0.0f, rays[first].offset, 1.0f / rays[first].distance, BLANK };
+	WallEdge right = { (float)((last + 1) * renderer.column_pixel_width), 0.0f, 0.0f, 0.0f, qLast, BLANK };
+	if (last == first)
+	{
+		right.u = MIN(left.u + widthPercent, 1.0f);
+	}
+	else
+	{
+		const float steps = (float)(last - first);
+		const float q = qLast + ((qLast - left.q) / steps);
+		const float uq = (rays[last].offset * qLast) + (((rays[last].offset * qLast) - (left.u * left.q)) / steps);
+		// Walls seen nearly edge on can extrapolate past the horizon, keep the last column's values then
+		right.q = q > 0.0f ? q : qLast;
+		right.u = q > 0.0f ? Clamp(uq / q, 0.0f, 1.0f) : rays[last].offset;
+	}
+
+	WallEdge *edges[2] = { &left, &right };
+	for (int i = 0; i < 2; i++)
+	{
+		const float height = VIEWPORT_HEIGHT * height_ratio * edges[i]->q;
+		edges[i]->top = (VIEWPORT_HEIGHT / 2) - (height / 2);
+		edges[i]->bottom = edges[i]->top + height;
+	}
+
+	if (shadingMode == FLAT)
+	{
+		// Sampling raylib's plain white texture
+		left.u = right.u = 0.0f;
+		left.tint = right.tint = FlatWallColor(&rays[first]);
+		AddWallSegment(&renderer.wallBatch, left, right, 0.0f, 0.0f);
+		return;
+	}
+
+	const Rectangle wall = GetWallTextureRect(atlas, rays[first].cell);
+	const float atlasWidth = (float)atlas->texture.width;
+	const float atlasHeight = (float)atlas->texture.height;
+	left.tint = GetWallTint(rays[first].hitX, 1.0f / left.q);
+	right.tint = GetWallTint(rays[first].hitX, 1.0f / right.q);
+	left.u = (wall.x + (left.u * wall.width)) / atlasWidth;
+	right.u = (wall.x + (right.u * wall.width)) / atlasWidth;
+	AddWallSegment(&renderer.wallBatch, left, right, wall.y / atlasHeight, (wall.y + wall.height) / atlasHeight);
+}
+
+/*
+ * Draws the walls as segments, every run of neighbouring rays that hit the same face of the same
+ * cell becomes a single quad. Only a handful of quads are left in a typical room instead of one
+ * per column.
+ */
+static void DrawWallRuns(const struct RayData rays[], const TextureAtlas *atlas)
+{
+	ClearWallBatch(&renderer.wallBatch);
+	int first = 0;
+	while (first <= renderer.ray_count)
+	{
+		int last = first;
+		int col, row;
+		if (GetRayHitCell(&rays[first], &col, &row))
+		{
+			int nextCol, nextRow;
+			while (last < renderer.ray_count &&
+				rays[last + 1].hitX == rays[first].hitX &&
+				GetRayHitCell(&rays[last + 1], &nextCol, &nextRow) &&
+				nextCol == col && nextRow == row)
+			{
+				last++;
+			}
+		}
+		AddWallRun(rays, first, last, atlas);
+		first = last + 1;
+	}
+	DrawWallBatch(&renderer.wallBatch, shadingMode == TEXTURED ? atlas->texture.id : rlGetTextureIdDefault());
+}
+
+// Stamps of map cell col, row, NULL if it is outside the map or the window
+static FanCell *GetFanCell(int col, int row)
+{
+	const int x = col - fanOriginCol;
+	const int y = row - fanOriginRow;
+	const int side = (2 * fanRadius) + 1;
+	if (col < 0 || row < 0 || col >= map->width || row >= map->height) { return NULL; }
+	if (x < 0 || y < 0 || x >= side || y >= side) { return NULL; }
+	return &fanCells[(y * side) + x];
+}
+
+/*
+ * Makes sure the stamp window reaches every cell a ray can cross plus the sprite reach around it,
+ * growing it if a sprite got bigger. The last step of a ray can end up to a cell past the draw
+ * distance. False if there is no window and sprites have to be culled without one.
+ */
+static bool ReserveFanWindow()
+{
+	const int radius = DRAW_DISTANCE + 2 + spriteReach;
+	if (fanCells != NULL && fanRadius >= radius) { return true; }
+
+	const int side = (2 * radius) + 1;
+	free(fanCells);
+	fanCells = calloc((size_t)side * side, sizeof(FanCell));
+	fanRadius = fanCells != NULL ? radius : 0;
+	fanStamp = 0;
+	return fanCells != NULL;
+}
+
+// Collects the sprites standing in a cell, once per frame
+static int QuerySpriteCell(int col, int row, int count)
+{
+	FanCell *cell = GetFanCell(col, row);
+	if (cell == NULL || cell->queried == fanStamp) { return count; }
+	cell->queried = fanStamp;
+	for (int id = GetSpatialHashCellFirst(&spriteHash, col, row); id != SPATIAL_HASH_END; id = GetSpatialHashCellNext(&spriteHash, id))
+	{
+		candidateSprites[count++] = sprites[id];
+	}
+	return count;
+}
+
+// Marks a cell a ray crossed, the first time each frame the sprites in reach of it are collected
+static int CrossFanCell(int col, int row, int count)
+{
+	FanCell *cell = GetFanCell(col, row);
+	if (cell == NULL || cell->crossed == fanStamp) { return count; }
+	cell->crossed = fanStamp;
+	for (int y = row - spriteReach; y <= row + spriteReach; y++)
+	{
+		for (int x = col - spriteReach; x <= col + spriteReach; x++)
+		{
+			count = QuerySpriteCell(x, y, count);
+		}
+	}
+	return count;
+}
+
+/*
+ * Gathers the sprites that could be visible into candidateSprites and returns how many. Rather
+ * than testing every sprite, only the cells the rays crossed on their way to a wall are looked up
+ * in spriteHash, together with the cells around them a sprite could poke into view from. Sprites
+ * out of sight behind walls are never touched, which makes for coarse occlusion culling.
+ */
+static int CollectSpriteCandidates(const struct RayData rays[])
+{
+	const Vector2 start = renderer.cameraPosition;
+	const int side = (2 * fanRadius) + 1;
+	fanOriginCol = (int)floorf(start.x) - fanRadius;
+	fanOriginRow = (int)floorf(start.y) - fanRadius;
+	// Stamps tell this frame's cells apart, so they only need clearing when the counter wraps
+	if (++fanStamp == 0)
 	{
-		// Calculate the height based on distance from camera
-		float height = (VIEWPORT_HEIGHT * height_ratio) / rays[i].distance;
-		float heightPercent = 1.0f;
+		memset(fanCells, 0, (size_t)side * side * sizeof(FanCell));
+		fanStamp = 1;
+	}
+
+	int count = 0;
+	for (int i = 0; i <= (int)renderer.ray_count; i++)
+	{
+		// Grid walk from the camera to the end of the ray
+		const Vector2 delta = Vector2Subtract(rays[i].end, start);
+		const int stepX = delta.x < 0.0f ? -1 : 1;
+		const int stepY = delta.y < 0.0f ? -1 : 1;
+		const Vector2 step = { fabsf(1.0f / delta.x), fabsf(1.0f / delta.y) };
+		int col = (int)floorf(start.x);
+		int row = (int)floorf(start.y);
+		const int steps = abs((int)floorf(rays[i].end.x) - col) + abs((int)floorf(rays[i].end.y) - row);
+		Vector2 next = {
+			(stepX < 0 ? start.x - (float)col : (float)(col + 1) - start.x) * step.x,
+			(stepY < 0 ? start.y - (float)row : (float)(row + 1) - start.y) * step.y
+		};
+
+		count = CrossFanCell(col, row, count);
+		for (int n = 0; n < steps; n++)
+		{
+			if (next.x < next.y)
+			{
+				col += stepX;
+				next.x += step.x;
+			}
+			else
+			{
+				row += stepY;
+				next.y += step.y;
+			}
+			count = CrossFanCell(col, row, count);
+		}
+	}
+	return count;
+}
 
-		float texOffset = (float)tex.height;
-		float texStartOffset = 0.0f;
-		/*TraceLog(LOG_INFO, "Height: %f | Radio: %f", height, height * HEIGHT_RATIO);*/
-		// Clamp the height so we don't draw outside of the viewport
-		if (height > VIEWPORT_HEIGHT) {
-			heightPercent = height / VIEWPORT_HEIGHT;
+/*
+ * Projects the sprites near the rays for the current camera, the ones in view end up in
+ * visibleSprites sorted back to front.
+ */
+static void ProjectVisibleSprites(const struct RayData rays[])
+{
+	const SpriteView view = {
+		renderer.cameraPosition,
+		renderer.cameraForward,
+		tanf(DEG2RAD * half_fov),
+		(float)X_MAX,
+		VIEWPORT_HEIGHT / 2.0f,
+		VIEWPORT_HEIGHT * height_ratio,
+		SPRITE_NEAR_DISTANCE,
+		(float)DRAW_DISTANCE
+	};
+	if (spriteCount > 0 && ReserveFanWindow())
+	{
+		visibleSpriteCount = ProjectSprites(candidateSprites, CollectSpriteCandidates(rays), &view, visibleSprites);
+	}
+	else
+	{
+		visibleSpriteCount = ProjectSprites(sprites, spriteCount, &view, visibleSprites);
+	}
+	SortSpritesBackToFront(visibleSprites, spriteScratch, visibleSpriteCount, view.farDistance);
+}
 
-			texStartOffset = 1.0f / heightPercent;
-			texOffset *= texStartOffset;
-			texStartOffset = ((1.0f - texStartOffset) / 2.0f) * tex.height;
+/*
+ * Columns whose centre a sprite covers, clamped to the screen. False if there are none, or the
+ * sprite's texture isn't in the atlas.
+ */
+static bool GetSpriteColumns(const ProjectedSprite *sprite, const TextureAtlas *atlas, int *first, int *last)
+{
+	if (sprite->texture < 0 || sprite->texture >= atlas->count) { return false; }
+	const float columnWidth = (float)renderer.column_pixel_width;
+	*first = MAX((int)ceilf((sprite->left / columnWidth) - 0.5f), 0);
+	*last = MIN((int)ceilf(((sprite->left + sprite->width) / columnWidth) - 0.5f) - 1, (int)renderer.ray_count);
+	return *first <= *last;
+}
 
-			// Keep height from exceeding height of viewport
-			height /= heightPercent;
+// Depth test against a column's ray, rays that ran out of draw distance hide sprites past it just
+// like walls
+static bool IsSpriteInFront(const ProjectedSprite *sprite, const struct RayData *ray)
+{
+	return sprite->depth < ray->distance;
+}
+
+/*
+ * Draws the sprites over the walls furthest first, with the ray distances as a depth buffer. Each
+ * sprite is cut into runs of the columns where it is nearer than the wall, columns behind a wall
+ * are never drawn. With batched walls on the runs all go into renderer.spriteBatch and out in one
+ * draw call.
+ */
+static void DrawSprites(const struct RayData rays[], const TextureAtlas *atlas)
+{
+	ProjectVisibleSprites(rays);
+	const bool batched = batchedWalls && IsWallBatchReady(renderer.spriteBatch);
+	const float columnWidth = (float)renderer.column_pixel_width;
+	const float atlasWidth = (float)atlas->texture.width;
+	const float atlasHeight = (float)atlas->texture.height;
+	ClearWallBatch(&renderer.spriteBatch);
+	for (int i = 0; i < visibleSpriteCount; i++)
+	{
+		const ProjectedSprite *sprite = &visibleSprites[i];
+		int first, last;
+		if (!GetSpriteColumns(sprite, atlas, &first, &last)) { continue; }
+
+		const Rectangle rect = GetAtlasRect(atlas, sprite->texture);
+		const Color tint = GetWallTint(true, sprite->depth);
+		while (first <= last)
+		{
+			if (!IsSpriteInFront(sprite, &rays[first])) { first++; continue; }
+			int end = first;
+			while (end < last && IsSpriteInFront(sprite, &rays[end + 1])) { end++; }
+
+			// Run edges cut to the sprite, the texture is stretched over the whole sprite
+			const float x0 = MAX(first * columnWidth, sprite->left);
+			const float x1 = MIN((end + 1) * columnWidth, sprite->left + sprite->width);
+			const float u0 = rect.x + (((x0 - sprite->left) / sprite->width) * rect.width);
+			const float u1 = rect.x + (((x1 - sprite->left) / sprite->width) * rect.width);
+			if (batched)
+			{
+				WallEdge left = { x0, sprite->top, sprite->top + sprite->height, u0 / atlasWidth, 1.0f, tint };
+				WallEdge right = { x1, sprite->top, sprite->top + sprite->height, u1 / atlasWidth, 1.0f, tint };
+				AddWallSegment(&renderer.spriteBatch, left, right, rect.y / atlasHeight, (rect.y + rect.height) / atlasHeight);
+			}
+			else
+			{
+				Rectangle texCoords = { u0, rect.y, u1 - u0, rect.height };
+				Rectangle position = { x0, sprite->top, x1 - x0, sprite->height };
+				DrawTexturePro(atlas->texture, texCoords, position, Vector2Zero(), 0.0f, tint);
+			}
+			first = end + 1;
 		}
+	}
+	if (batched) { DrawWallBatch(&renderer.spriteBatch, atlas->texture.id); }
+}
 
-		/*TraceLog(LOG_INFO, "height: %f", height);*/
+typedef struct SpriteDrawJob {
+	SoftwareFramebuffer *target;
+	const struct RayData *rays;
+	const SoftwareTexture *texture;
+	const TextureAtlas *atlas;
+} SpriteDrawJob;
 
-		Color wallColor = DARKGRAY;
-		// Shade walls darker if they are perpedicular
-		if (rays[i].hitX) {
-			wallColor = WHITE;
+// Job drawing every visible sprite's columns within a chunk of columns, furthest first
+static void DrawSpriteChunk(void *data, int firstColumn, int count)
+{
+	const SpriteDrawJob *job = data;
+	const int columnWidth = renderer.column_pixel_width;
+	for (int i = 0; i < visibleSpriteCount; i++)
+	{
+		const ProjectedSprite *sprite = &visibleSprites[i];
+		int first, last;
+		if (!GetSpriteColumns(sprite, job->atlas, &first, &last)) { continue; }
+		first = MAX(first, firstColumn);
+		last = MIN(last, firstColumn + count - 1);
+
+		const Rectangle rect = GetAtlasRect(job->atlas, sprite->texture);
+		const Color tint = GetWallTint(true, sprite->depth);
+		for (int column = first; column <= last; column++)
+		{
+			if (!IsSpriteInFront(sprite, &job->rays[column])) { continue; }
+			// Texel under the column's centre
+			const float u = (((((float)column + 0.5f) * columnWidth) - sprite->left) / sprite->width) * rect.width;
+			SoftwareDrawSpriteColumn(
+				job->target,
+				job->texture,
+				column * columnWidth,
+				columnWidth,
+				sprite->top,
+				sprite->height,
+				rect.x + MIN(u, rect.width - 1.0f),
+				rect.y,
+				rect.height,
+				tint
+			);
 		}
-		// Scale for brightness, lower number reduces amount of "light" emitted by player
-		const float brightnessScaler = 4.0f;
-		float brightness = brightnessScaler / rays[i].distance;
-		if (brightness > 1.0f) { brightness = 1.0f; }
-		wallColor.r *= brightness;
-		wallColor.g *= brightness;
-		wallColor.b *= brightness;
+	}
+}
+
+/*
+ * Software version of DrawSprites(), draws the visible columns of each sprite into target. Every
+ * chunk of columns is drawn by its own job, which keeps the back to front order within a column.
+ */
+static void DrawSpritesSoftware(SoftwareFramebuffer *target, const struct RayData rays[], const SoftwareTexture *tex, const TextureAtlas *atlas)
+{
+	ProjectVisibleSprites(rays);
+	if (visibleSpriteCount == 0) { return; }
+	SpriteDrawJob job = { target, rays, tex, atlas };
+	RunParallelFor(DrawSpriteChunk, &job, renderer.ray_count + 1, SPRITE_COLUMN_CHUNK_SIZE);
+}
+
+/*
+ * Draws the 3D version of the map. Takes an array of rays that have been filled by DDANonLinear().
+ * Also takes the atlas holding the wall textures, each column uses the texture of the map cell its
+ * ray hit. Draws Ceiling and Floor first, textured per cell unless shading is flat.  Next goes
+ * through the ray data and draws each column at a fixed width and adjsuts the height based on
+ * distance from the Player. With batched walls on the columns are merged into wall segments and
+ * drawn with one draw call instead, see DrawWallRuns(). Sprites go last, see DrawSprites().
+ */
+void Draw3D(const struct RayData rays[], const TextureAtlas *atlas)
+{
+	const float widthPercent = (float)renderer.column_pixel_width / (float)VIEWPORT_WIDTH;
+	if (shadingMode == TEXTURED)
+	{
+		// Draw Ceiling and Floor (Textured), cast on the CPU into the software backend's
+		// framebuffer which is free while this backend is in use
+		CastFloorAndCeiling(&renderer.framebuffer);
+		UpdateTexture(renderer.framebufferTex, renderer.framebuffer.pixels);
+		DrawTexture(renderer.framebufferTex, 0, 0, WHITE);
+	}
+	else
+	{
+		// Draw Ceiling
+		DrawRectangle(0, 0, VIEWPORT_WIDTH, VIEWPORT_HEIGHT / 2, LIGHTGRAY);
+		// Draw Floor
+		DrawRectangle(0, VIEWPORT_HEIGHT / 2, VIEWPORT_WIDTH, VIEWPORT_HEIGHT / 2, DARKGRAY);
+	}
+	// Walls
+	if (batchedWalls && IsWallBatchReady(renderer.wallBatch))
+	{
+		DrawWallRuns(rays, atlas);
+		DrawSprites(rays, atlas);
+		return;
+	}
+	for (int i = 0; i <= renderer.ray_count; i++)
+	{
+		const Rectangle wall = GetWallTextureRect(atlas, rays[i].cell);
+		WallColumn column = ComputeWallColumn(&rays[i], wall.height);
 
 		if (shadingMode == TEXTURED)
 		{
-			// Draw Wall (Textured)
+			// Draw Wall (Textured), kept inside the wall's rect so no neighbouring texture shows
+			const float texWidth = widthPercent * wall.width;
 			Rectangle texCoords = (Rectangle){
-				rays[i].offset * tex.width,
-				texStartOffset,
-				widthPercent * tex.width,
-				texOffset,
+				wall.x + MIN(rays[i].offset * wall.width, wall.width - texWidth),
+				wall.y + column.texStart,
+				texWidth,
+				column.texSpan,
 			};
 			Rectangle position = (Rectangle){
 				i * renderer.column_pixel_width,
-				(VIEWPORT_HEIGHT / 2) - (height / 2),
+				column.top,
 				renderer.column_pixel_width,
-				height,
+				column.height,
 			};
 			DrawTexturePro(
-				tex,
+				atlas->texture,
 				texCoords,
 				position,
 				Vector2Zero(),
 				0.0f,
-				wallColor
+				column.tint
 			);
 		}
 		else if (shadingMode == FLAT)
 		{
-			wallColor = RED;
-			// Shade walls darker if they are perpedicular
-			if (!rays[i].hitX) {
-				wallColor.r *= 0.5f;
-				wallColor.g *= 0.5f;
-				wallColor.b *= 0.5f;
-			}
 			// Draw Wall (Flat Shaded)
 			DrawRectangle(
 				i * renderer.column_pixel_width,
-				(VIEWPORT_HEIGHT / 2) - (height / 2),
+				column.top,
+				renderer.column_pixel_width,
+				column.height,
+				FlatWallColor(&rays[i])
+			);
+		}
+	}
+	DrawSprites(rays, atlas);
+}
+
+/*
+ * Software version of Draw2D(), rasterizes the automap into renderer.framebuffer.
+ */
+void Draw2DSoftware(const struct RayData rays[])
+{
+	SoftwareFramebuffer *framebuffer = &renderer.framebuffer;
+	int firstCol, firstRow, lastCol, lastRow;
+	UpdateAutomapView(&firstCol, &firstRow, &lastCol, &lastRow);
+
+	// Draw Map
+	for (int row = firstRow; row <= lastRow; row++)
+	{
+		for (int col = firstCol; col <= lastCol; col++)
+		{
+			Vector2 tile = MapToAutomap((Vector2){ (float)col, (float)row });
+			Color cellColor = IsMapWall(map, col, row) ? RED : BLUE;
+			SoftwareDrawRectangle(framebuffer, tile.x, tile.y, tile_size_pixels - 2, tile_size_pixels - 2, cellColor);
+		}
+	}
+
+	for (int i = 0; i <= renderer.ray_count; i++)
+	{
+		bool centre = i >= (renderer.ray_count / 2) - 3 && i <= (renderer.ray_count / 2) + 3;
+		Vector2 start = MapToAutomap(rays[i].start);
+		Vector2 end = MapToAutomap(rays[i].end);
+		SoftwareDrawLine(framebuffer, start.x, start.y, end.x, end.y, centre ? YELLOW : PURPLE);
+	}
+
+	// Draw Player
+	Vector2 camera = MapToAutomap(renderer.cameraPosition);
+	SoftwareDrawCircle(framebuffer, camera.x, camera.y, 0.2 * tile_size_pixels, GREEN);
+	Vector2 temp = renderer.cameraForward;
+	temp = Vector2Scale(temp, 25.0f);
+	temp = Vector2Add(temp, camera);
+	SoftwareDrawLine(framebuffer, camera.x, camera.y, temp.x, temp.y, GREEN);
+}
+
+/*
+ * Software version of Draw3D(), rasterizes ceiling, floor, wall columns and sprites into
+ * renderer.framebuffer. tex is the CPU copy of the wall atlas.
+ */
+void Draw3DSoftware(const struct RayData rays[], const SoftwareTexture *tex, const TextureAtlas *atlas)
+{
+	SoftwareFramebuffer *framebuffer = &renderer.framebuffer;
+	if (shadingMode == TEXTURED)
+	{
+		// Draw Ceiling and Floor (Textured)
+		CastFloorAndCeiling(framebuffer);
+	}
+	else
+	{
+		// Draw Ceiling
+		SoftwareDrawRectangle(framebuffer, 0, 0, VIEWPORT_WIDTH, VIEWPORT_HEIGHT / 2, LIGHTGRAY);
+		// Draw Floor
+		SoftwareDrawRectangle(framebuffer, 0, VIEWPORT_HEIGHT / 2, VIEWPORT_WIDTH, VIEWPORT_HEIGHT / 2, DARKGRAY);
+	}
+	// Walls
+	for (int i = 0; i <= renderer.ray_count; i++)
+	{
+		const Rectangle wall = GetWallTextureRect(atlas, rays[i].cell);
+		WallColumn column = ComputeWallColumn(&rays[i], wall.height);
+
+		if (shadingMode == TEXTURED)
+		{
+			SoftwareDrawTexturedColumn(
+				framebuffer,
+				tex,
+				i * renderer.column_pixel_width,
+				renderer.column_pixel_width,
+				column.top,
+				column.height,
+				wall.x + MIN(rays[i].offset * wall.width, wall.width - 1.0f),
+				wall.y + column.texStart,
+				column.texSpan,
+				column.tint
+			);
+		}
+		else if (shadingMode == FLAT)
+		{
+			SoftwareDrawRectangle(
+				framebuffer,
+				i * renderer.column_pixel_width,
+				column.top,
 				renderer.column_pixel_width,
-				height,
-				wallColor
+				column.height,
+				FlatWallColor(&rays[i])
 			);
 		}
 	}
+	DrawSpritesSoftware(framebuffer, rays, tex, atlas);
 }
 
 /*
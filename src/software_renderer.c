@@ -0,0 +1,210 @@
+#include "software_renderer.h"
+#include "helpful_math.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+SoftwareFramebuffer LoadSoftwareFramebuffer(int width, int height)
+{
+	SoftwareFramebuffer framebuffer = { 0 };
+	framebuffer.width = width;
+	framebuffer.height = height;
+	framebuffer.pixels = calloc((size_t)width * height, sizeof(uint32_t));
+	return framebuffer;
+}
+
+void UnloadSoftwareFramebuffer(SoftwareFramebuffer framebuffer)
+{
+	free(framebuffer.pixels);
+}
+
+/*
+ * Loads an image file into a CPU texture. Works without a window or GL context.
+ */
+SoftwareTexture LoadSoftwareTexture(const char *fileName)
+{
+	Image image = LoadImage(fileName);
+	SoftwareTexture texture = LoadSoftwareTextureFromImage(image);
+	UnloadImage(image);
+
+	return texture;
+}
+
+/*
+ * CPU texture with a copy of the image's pixels, converted to R8G8B8A8 if needed.
+ */
+SoftwareTexture LoadSoftwareTextureFromImage(Image image)
+{
+	SoftwareTexture texture = { 0 };
+	if (image.data == NULL) { return texture; }
+
+	Image converted = image;
+	if (image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+	{
+		converted = ImageCopy(image);
+		ImageFormat(&converted, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+	}
+	texture.width = converted.width;
+	texture.height = converted.height;
+	texture.pixels = malloc((size_t)converted.width * converted.height * sizeof(uint32_t));
+	memcpy(texture.pixels, converted.data, (size_t)converted.width * converted.height * sizeof(uint32_t));
+	if (converted.data != image.data) { UnloadImage(converted); }
+
+	return texture;
+}
+
+void UnloadSoftwareTexture(SoftwareTexture texture)
+{
+	free(texture.pixels);
+}
+
+uint32_t ColorToPixel(Color color)
+{
+	return (uint32_t)color.r | ((uint32_t)color.g << 8) | ((uint32_t)color.b << 16) | ((uint32_t)color.a << 24);
+}
+
+// Same as raylib's tint, each channel is scaled by tint / 255
+static uint32_t TintPixel(uint32_t pixel, Color tint)
+{
+	uint32_t r = ((pixel & 0xFF) * tint.r) / 255;
+	uint32_t g = (((pixel >> 8) & 0xFF) * tint.g) / 255;
+	uint32_t b = (((pixel >> 16) & 0xFF) * tint.b) / 255;
+	return r | (g << 8) | (b << 16) | 0xFF000000;
+}
+
+void SoftwareClear(SoftwareFramebuffer *framebuffer, Color color)
+{
+	SoftwareDrawRectangle(framebuffer, 0, 0, framebuffer->width, framebuffer->height, color);
+}
+
+void SoftwareDrawRectangle(SoftwareFramebuffer *framebuffer, int posX, int posY, int width, int height, Color color)
+{
+	// Clip against the framebuffer
+	int x0 = MAX(posX, 0);
+	int y0 = MAX(posY, 0);
+	int x1 = MIN(posX + width, framebuffer->width);
+	int y1 = MIN(posY + height, framebuffer->height);
+	const uint32_t pixel = ColorToPixel(color);
+
+	for (int y = y0; y < y1; y++)
+	{
+		uint32_t *row = framebuffer->pixels + ((size_t)y * framebuffer->width);
+		for (int x = x0; x < x1; x++)
+		{
+			row[x] = pixel;
+		}
+	}
+}
+
+/*
+ * Bresenham line, pixels outside the framebuffer are skipped.
+ */
+void SoftwareDrawLine(SoftwareFramebuffer *framebuffer, int startPosX, int startPosY, int endPosX, int endPosY, Color color)
+{
+	const uint32_t pixel = ColorToPixel(color);
+	int dx = abs(endPosX - startPosX);
+	int dy = -abs(endPosY - startPosY);
+	int stepX = startPosX < endPosX ? 1 : -1;
+	int stepY = startPosY < endPosY ? 1 : -1;
+	int error = dx + dy;
+	int x = startPosX;
+	int y = startPosY;
+
+	while (true)
+	{
+		if (x >= 0 && y >= 0 && x < framebuffer->width && y < framebuffer->height)
+		{
+			framebuffer->pixels[(size_t)y * framebuffer->width + x] = pixel;
+		}
+		if (x == endPosX && y == endPosY) { break; }
+
+		int error2 = error * 2;
+		if (error2 >= dy) { error += dy; x += stepX; }
+		if (error2 <= dx) { error += dx; y += stepY; }
+	}
+}
+
+void SoftwareDrawCircle(SoftwareFramebuffer *framebuffer, int centerX, int centerY, float radius, Color color)
+{
+	const uint32_t pixel = ColorToPixel(color);
+	const int r = (int)ceilf(radius);
+	const float radiusSqr = radius * radius;
+
+	for (int y = MAX(centerY - r, 0); y <= MIN(centerY + r, framebuffer->height - 1); y++)
+	{
+		for (int x = MAX(centerX - r, 0); x <= MIN(centerX + r, framebuffer->width - 1); x++)
+		{
+			float dx = (float)(x - centerX);
+			float dy = (float)(y - centerY);
+			if ((dx * dx) + (dy * dy) <= radiusSqr)
+			{
+				framebuffer->pixels[(size_t)y * framebuffer->width + x] = pixel;
+			}
+		}
+	}
+}
+
+/*
+ * Draws one wall column. The texture column at texX is stretched so that texel rows
+ * [texStart, texStart + texSpan) cover the screen rows [top, top + height). The v coordinate is
+ * stepped in 16.16 fixed point so the inner loop is one add and one lookup per pixel.
+ */
+void SoftwareDrawTexturedColumn(SoftwareFramebuffer *framebuffer, const SoftwareTexture *texture, int posX, int width, float top, float height, float texX, float texStart, float texSpan, Color tint)
+{
+	if (height <= 0.0f || texture->pixels == NULL) { return; }
+
+	const int x0 = MAX(posX, 0);
+	const int x1 = MIN(posX + width, framebuffer->width);
+	const int y0 = MAX((int)top, 0);
+	const int y1 = MIN((int)(top + height), framebuffer->height);
+	const int u = MIN(MAX((int)texX, 0), texture->width - 1);
+
+	const float vStep = texSpan / height;
+	int32_t v = (int32_t)((texStart + (((float)y0 - top) * vStep)) * 65536.0f);
+	const int32_t vStepFixed = (int32_t)(vStep * 65536.0f);
+
+	for (int y = y0; y < y1; y++)
+	{
+		int texY = MIN(MAX(v >> 16, 0), texture->height - 1);
+		uint32_t pixel = TintPixel(texture->pixels[(size_t)texY * texture->width + u], tint);
+		uint32_t *row = framebuffer->pixels + ((size_t)y * framebuffer->width);
+		for (int x = x0; x < x1; x++)
+		{
+			row[x] = pixel;
+		}
+		v += vStepFixed;
+	}
+}
+
+/*
+ * Same as SoftwareDrawTexturedColumn() but for sprites, texels less than half opaque are skipped so
+ * whatever is behind the sprite shows through.
+ */
+void SoftwareDrawSpriteColumn(SoftwareFramebuffer *framebuffer, const SoftwareTexture *texture, int posX, int width, float top, float height, float texX, float texStart, float texSpan, Color tint)
+{
+	if (height <= 0.0f || texture->pixels == NULL) { return; }
+
+	const int x0 = MAX(posX, 0);
+	const int x1 = MIN(posX + width, framebuffer->width);
+	const int y0 = MAX((int)top, 0);
+	const int y1 = MIN((int)(top + height), framebuffer->height);
+	const int u = MIN(MAX((int)texX, 0), texture->width - 1);
+
+	const float vStep = texSpan / height;
+	int32_t v = (int32_t)((texStart + (((float)y0 - top) * vStep)) * 65536.0f);
+	const int32_t vStepFixed = (int32_t)(vStep * 65536.0f);
+
+	for (int y = y0; y < y1; y++, v += vStepFixed)
+	{
+		int texY = MIN(MAX(v >> 16, 0), texture->height - 1);
+		const uint32_t texel = texture->pixels[(size_t)texY * texture->width + u];
+		if ((texel >> 24) < 128) { continue; }
+
+		uint32_t pixel = TintPixel(texel, tint);
+		uint32_t *row = framebuffer->pixels + ((size_t)y * framebuffer->width);
+		for (int x = x0; x < x1; x++)
+		{
+			row[x] = pixel;
+		}
+	}
+}
@@ -0,0 +1,133 @@
+#include "spatial_hash.h"
+#include "helpful_math.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int GetBucket(const SpatialHash *hash, int col, int row)
+{
+	const unsigned int key = ((unsigned int)col * 73856093u) ^ ((unsigned int)row * 19349663u);
+	return (int)(key & (unsigned int)hash->bucketMask);
+}
+
+/*
+ * Makes room for objects 0 to capacity - 1, with about as many buckets as objects.
+ */
+SpatialHash LoadSpatialHash(int capacity)
+{
+	SpatialHash hash = { 0 };
+	int bucketCount = 16;
+	while (bucketCount < capacity) { bucketCount *= 2; }
+
+	hash.buckets = malloc(bucketCount * sizeof(int));
+	hash.entries = malloc(MAX(capacity, 1) * sizeof(SpatialHashEntry));
+	if (hash.buckets == NULL || hash.entries == NULL)
+	{
+		free(hash.buckets);
+		free(hash.entries);
+		return (SpatialHash){ 0 };
+	}
+	hash.capacity = capacity;
+	hash.bucketMask = bucketCount - 1;
+	ClearSpatialHash(&hash);
+	return hash;
+}
+
+void UnloadSpatialHash(SpatialHash hash)
+{
+	free(hash.buckets);
+	free(hash.entries);
+}
+
+/*
+ * Removes every object.
+ */
+void ClearSpatialHash(SpatialHash *hash)
+{
+	if (hash->buckets == NULL) { return; }
+	memset(hash->buckets, 0xff, (hash->bucketMask + 1) * sizeof(int));
+	for (int i = 0; i < hash->capacity; i++)
+	{
+		hash->entries[i].inserted = false;
+	}
+}
+
+/*
+ * Files object id under the cell position is in. Objects already in the hash are moved instead.
+ */
+void InsertSpatialHash(SpatialHash *hash, int id, Vector2 position)
+{
+	if (id < 0 || id >= hash->capacity) { return; }
+	if (hash->entries[id].inserted)
+	{
+		MoveSpatialHash(hash, id, position);
+		return;
+	}
+
+	SpatialHashEntry *entry = &hash->entries[id];
+	entry->col = (int)floorf(position.x);
+	entry->row = (int)floorf(position.y);
+	const int bucket = GetBucket(hash, entry->col, entry->row);
+	entry->prev = SPATIAL_HASH_END;
+	entry->next = hash->buckets[bucket];
+	if (entry->next != SPATIAL_HASH_END) { hash->entries[entry->next].prev = id; }
+	hash->buckets[bucket] = id;
+	entry->inserted = true;
+}
+
+void RemoveSpatialHash(SpatialHash *hash, int id)
+{
+	if (id < 0 || id >= hash->capacity || !hash->entries[id].inserted) { return; }
+
+	SpatialHashEntry *entry = &hash->entries[id];
+	if (entry->prev != SPATIAL_HASH_END)
+	{
+		hash->entries[entry->prev].next = entry->next;
+	}
+	else
+	{
+		hash->buckets[GetBucket(hash, entry->col, entry->row)] = entry->next;
+	}
+	if (entry->next != SPATIAL_HASH_END) { hash->entries[entry->next].prev = entry->prev; }
+	entry->inserted = false;
+}
+
+/*
+ * Refiles object id after it moved to position, only touches the lists if it changed cells.
+ */
+void MoveSpatialHash(SpatialHash *hash, int id, Vector2 position)
+{
+	if (id < 0 || id >= hash->capacity) { return; }
+
+	const SpatialHashEntry *entry = &hash->entries[id];
+	if (entry->inserted && entry->col == (int)floorf(position.x) && entry->row == (int)floorf(position.y)) { return; }
+	RemoveSpatialHash(hash, id);
+	InsertSpatialHash(hash, id, position);
+}
+
+// First object from id on that is in the cell, the bucket may hold other cells too
+static int SkipToCell(const SpatialHash *hash, int id, int col, int row)
+{
+	while (id != SPATIAL_HASH_END && (hash->entries[id].col != col || hash->entries[id].row != row))
+	{
+		id = hash->entries[id].next;
+	}
+	return id;
+}
+
+/*
+ * Walks the objects in a cell together with GetSpatialHashCellNext(), SPATIAL_HASH_END once there
+ * are no more. The hash can't change during the walk.
+ */
+int GetSpatialHashCellFirst(const SpatialHash *hash, int col, int row)
+{
+	if (hash->buckets == NULL) { return SPATIAL_HASH_END; }
+	return SkipToCell(hash, hash->buckets[GetBucket(hash, col, row)], col, row);
+}
+
+int GetSpatialHashCellNext(const SpatialHash *hash, int id)
+{
+	const SpatialHashEntry *entry = &hash->entries[id];
+	return SkipToCell(hash, entry->next, entry->col, entry->row);
+}
@@ -0,0 +1,92 @@
+#include "sphere_dda.h"
+#include "helpful_math.h"
+
+// Stand-in for the distance to a grid line the ray runs parallel to
+#define NO_STEP 1e30f
+
+/*
+ * Distance along the ray to the vertical (or horizontal) grid line at line, inverseDir is 1 / the
+ * ray direction along that axis. Rays that never move along that axis never reach it.
+ */
+static float DistanceToLine(float line, float start, float inverseDir)
+{
+	return inverseDir != 0.0f ? (line - start) * inverseDir : NO_STEP;
+}
+
+/*
+ * Sphere tracing on the grid. The distance field says how far the open square around the current
+ * cell reaches, the ray crosses straight to the far side of that square and only falls back to
+ * single cell steps right next to walls, where the square is just the cell itself. Every grid line
+ * crossed on the way lies inside an open square so the ray stops at exactly the same wall and
+ * distance as stepping one cell at a time.
+ */
+static void CastRaySphere(struct RayData *ray, Vector2 forward, float correction, Vector2 position, const DistanceField *field, const OccupancyGrid *grid, float maxDistance)
+{
+	const int dirX = forward.x < 0 ? -1 : 1;
+	const int dirY = forward.y < 0 ? -1 : 1;
+	// Zero on an axis the ray doesn't move along, see DistanceToLine()
+	const float inverseX = forward.x != 0.0f ? 1.0f / forward.x : 0.0f;
+	const float inverseY = forward.y != 0.0f ? 1.0f / forward.y : 0.0f;
+
+	// Convert pixel coords into map grid coords
+	int mapCol = position.x;
+	int mapRow = position.y;
+	// Squares that reach past the draw distance are never crossed whole, the last few cells before
+	// it are stepped one at a time so the ray stops where the scalar loop does
+	bool nearDrawDistance = false;
+	bool hitX = false;
+	float distanceChecked = 0.0f;
+
+	int steps = 0;
+	bool hitWall = false;
+	while (!hitWall && distanceChecked < maxDistance)
+	{
+		const int radius = nearDrawDistance ? 0 : MAX(GetDistanceFieldValue(field, mapCol, mapRow) - 1, 0);
+		const float lengthX = DistanceToLine((float)(dirX > 0 ? mapCol + radius + 1 : mapCol - radius), position.x, inverseX);
+		const float lengthY = DistanceToLine((float)(dirY > 0 ? mapRow + radius + 1 : mapRow - radius), position.y, inverseY);
+		const float length = MIN(lengthX, lengthY);
+		if (radius > 0 && length >= maxDistance)
+		{
+			nearDrawDistance = true;
+			continue;
+		}
+
+		// Step along shortest length into the cell on the far side of the square
+		hitX = lengthX < lengthY;
+		if (hitX)
+		{
+			mapRow = MIN(MAX((int)floorf(position.y + forward.y * length), mapRow - radius), mapRow + radius);
+			mapCol += dirX * (radius + 1);
+		}
+		else
+		{
+			mapCol = MIN(MAX((int)floorf(position.x + forward.x * length), mapCol - radius), mapCol + radius);
+			mapRow += dirY * (radius + 1);
+		}
+		distanceChecked = length;
+		steps++;
+
+		hitWall = IsCellOccupied(grid, mapCol, mapRow);
+	}
+
+	ray->start = position;
+	ray->end = Vector2Add(position, Vector2Scale(forward, distanceChecked));
+	// Save for rendering shadowed walls
+	ray->hitX = hitX;
+	ray->distance = distanceChecked * correction;
+	ray->offset = fmodf(hitX ? ray->end.y : ray->end.x, 1.0f);
+	ray->steps = steps;
+}
+
+/*
+ * Casts rays[first] to rays[first + count - 1] using the distance field to skip open space. Takes
+ * the same per-ray directions and fisheye corrections as CastRayPackets(), walls are read from the
+ * occupancy grid.
+ */
+void CastRaysSphere(struct RayData rays[], const Vector2 forward[], const float correction[], int first, int count, Vector2 position, const DistanceField *field, const OccupancyGrid *grid, float maxDistance)
+{
+	for (int i = first; i < first + count; i++)
+	{
+		CastRaySphere(&rays[i], forward[i], correction[i], position, field, grid, maxDistance);
+	}
+}
@@ -0,0 +1,82 @@
+#include "sprite.h"
+#include "helpful_math.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define SPRITE_DEPTH_BITS 16
+#define SPRITE_RADIX_BITS 8
+
+/*
+ * Projects the sprites onto the screen and keeps the ones inside the view frustum: in front of the
+ * near distance, before the far distance and overlapping the screen horizontally. projected needs
+ * room for count sprites, returns how many were kept.
+ */
+int ProjectSprites(const Sprite sprites[], int count, const SpriteView *view, ProjectedSprite projected[])
+{
+	const Vector2 across = { -view->forward.y, view->forward.x };
+	// Pixels per cell sideways at distance 1, the same spread the rays have across the screen
+	const float widthScale = view->screenWidth / (2.0f * view->tanHalfFov);
+	int kept = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const Vector2 offset = Vector2Subtract(sprites[i].position, view->position);
+		const float depth = Vector2DotProduct(offset, view->forward);
+		if (depth < view->nearDistance || depth > view->farDistance) { continue; }
+
+		const float width = (sprites[i].size * widthScale) / depth;
+		const float centre = (view->screenWidth / 2.0f) + ((Vector2DotProduct(offset, across) * widthScale) / depth);
+		if (centre + (width / 2.0f) < 0.0f || centre - (width / 2.0f) > view->screenWidth) { continue; }
+
+		// Stands on the floor, which is half a wall below the horizon
+		const float bottom = view->horizon + ((view->heightScale / 2.0f) / depth);
+		const float height = (sprites[i].size * view->heightScale) / depth;
+		projected[kept++] = (ProjectedSprite){ depth, centre - (width / 2.0f), bottom - height, width, height, sprites[i].texture };
+	}
+	return kept;
+}
+
+// Quantized depth, inverted so further sprites get smaller keys
+static uint32_t GetSpriteKey(const ProjectedSprite *sprite, float keyScale)
+{
+	const float maxKey = (float)((1u << SPRITE_DEPTH_BITS) - 1);
+	return (uint32_t)(maxKey - Clamp(sprite->depth * keyScale, 0.0f, maxKey));
+}
+
+/*
+ * Sorts furthest first so nearer sprites are drawn over further ones. Depths are quantized to
+ * SPRITE_DEPTH_BITS between 0 and farDistance and sorted with a stable least significant digit
+ * radix sort, SPRITE_RADIX_BITS per pass. scratch needs room for count sprites.
+ */
+void SortSpritesBackToFront(ProjectedSprite sprites[], ProjectedSprite scratch[], int count, float farDistance)
+{
+	const uint32_t digitMask = (1u << SPRITE_RADIX_BITS) - 1;
+	const float keyScale = (float)((1u << SPRITE_DEPTH_BITS) - 1) / farDistance;
+	ProjectedSprite *from = sprites;
+	ProjectedSprite *to = scratch;
+	for (int shift = 0; shift < SPRITE_DEPTH_BITS; shift += SPRITE_RADIX_BITS)
+	{
+		int offsets[1 << SPRITE_RADIX_BITS] = { 0 };
+		for (int i = 0; i < count; i++)
+		{
+			offsets[(GetSpriteKey(&from[i], keyScale) >> shift) & digitMask]++;
+		}
+		int total = 0;
+		for (int digit = 0; digit < (1 << SPRITE_RADIX_BITS); digit++)
+		{
+			const int digitCount = offsets[digit];
+			offsets[digit] = total;
+			total += digitCount;
+		}
+		for (int i = 0; i < count; i++)
+		{
+			to[offsets[(GetSpriteKey(&from[i], keyScale) >> shift) & digitMask]++] = from[i];
+		}
+
+		ProjectedSprite *swap = from;
+		from = to;
+		to = swap;
+	}
+	// An odd number of passes leaves the result in scratch
+	if (from != sprites) { memcpy(sprites, from, count * sizeof(ProjectedSprite)); }
+}
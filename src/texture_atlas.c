@@ -0,0 +1,103 @@
+#include "texture_atlas.h"
+#include "helpful_math.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Loads the images and packs them into one image. The images are placed tallest first left to
+ * right in rows as high as their first image, in an atlas with a power of two width big enough
+ * for all of them. Images that fail to load get an empty rect. Only needs the image loader, call
+ * UploadTextureAtlas() once there is a GL context.
+ */
+TextureAtlas LoadTextureAtlas(const char *const fileNames[], int count)
+{
+	TextureAtlas atlas = { 0 };
+	atlas.count = MIN(count, ATLAS_MAX_TEXTURES);
+
+	Image images[ATLAS_MAX_TEXTURES];
+	int order[ATLAS_MAX_TEXTURES];
+	long area = 0;
+	int widest = 1;
+	for (int i = 0; i < atlas.count; i++)
+	{
+		images[i] = LoadImage(fileNames[i]);
+		if (images[i].data != NULL)
+		{
+			ImageFormat(&images[i], PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+			area += (long)images[i].width * images[i].height;
+			widest = MAX(widest, images[i].width);
+		}
+
+		// Insertion sort by height, tallest first
+		int slot = i;
+		while (slot > 0 && images[order[slot - 1]].height < images[i].height)
+		{
+			order[slot] = order[slot - 1];
+			slot--;
+		}
+		order[slot] = i;
+	}
+
+	int width = 1;
+	while (width < widest || (long)width * width < area) { width *= 2; }
+
+	int x = 0;
+	int y = 0;
+	int rowHeight = 0;
+	for (int k = 0; k < atlas.count; k++)
+	{
+		const Image *image = &images[order[k]];
+		if (image->data == NULL) { continue; }
+
+		if (x + image->width > width)
+		{
+			x = 0;
+			y += rowHeight;
+			rowHeight = 0;
+		}
+		atlas.rects[order[k]] = (Rectangle){ (float)x, (float)y, (float)image->width, (float)image->height };
+		x += image->width;
+		rowHeight = MAX(rowHeight, image->height);
+	}
+
+	atlas.image = GenImageColor(width, MAX(y + rowHeight, 1), BLANK);
+	uint32_t *pixels = atlas.image.data;
+	for (int i = 0; i < atlas.count; i++)
+	{
+		if (images[i].data == NULL) { continue; }
+
+		const Rectangle rect = atlas.rects[i];
+		for (int row = 0; row < images[i].height; row++)
+		{
+			memcpy(
+				&pixels[(((size_t)rect.y + row) * width) + (size_t)rect.x],
+				(const uint32_t *)images[i].data + ((size_t)row * images[i].width),
+				images[i].width * sizeof(uint32_t)
+			);
+		}
+		UnloadImage(images[i]);
+	}
+
+	return atlas;
+}
+
+/*
+ * Creates the GPU copy of the atlas, needs a GL context.
+ */
+void UploadTextureAtlas(TextureAtlas *atlas)
+{
+	atlas->texture = LoadTextureFromImage(atlas->image);
+}
+
+void UnloadTextureAtlas(TextureAtlas atlas)
+{
+	UnloadImage(atlas.image);
+	if (atlas.texture.id != 0) { UnloadTexture(atlas.texture); }
+}
+
+// Where texture index is in the atlas, an empty rect if there is no such texture
+Rectangle GetAtlasRect(const TextureAtlas *atlas, int index)
+{
+	return index >= 0 && index < atlas->count ? atlas->rects[index] : (Rectangle){ 0 };
+}
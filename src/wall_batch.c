@@ -0,0 +1,208 @@
+#include "wall_batch.h"
+#include "raymath.h"
+#include "rlgl.h"
+
+#include <stdlib.h>
+
+// Same as raylib's default shader except the texture coordinates are divided by their q first,
+// which interpolates them perspective correct across a wall segment
+#if defined(GRAPHICS_API_OPENGL_33) || defined(GRAPHICS_API_OPENGL_43) || defined(GRAPHICS_API_OPENGL_ES3)
+#if defined(GRAPHICS_API_OPENGL_ES3)
+#define WALL_SHADER_HEADER "#version 300 es\nprecision mediump float;\n"
+#else
+#define WALL_SHADER_HEADER "#version 330\n"
+#endif
+static const char *wallVertexShader =
+	WALL_SHADER_HEADER
+	"in vec3 vertexPosition;\n"
+	"in vec3 vertexTexCoord;\n"
+	"in vec4 vertexColor;\n"
+	"out vec3 fragTexCoord;\n"
+	"out vec4 fragColor;\n"
+	"uniform mat4 mvp;\n"
+	"void main()\n"
+	"{\n"
+	"	fragTexCoord = vertexTexCoord;\n"
+	"	fragColor = vertexColor;\n"
+	"	gl_Position = mvp * vec4(vertexPosition, 1.0);\n"
+	"}\n";
+static const char *wallFragmentShader =
+	WALL_SHADER_HEADER
+	"in vec3 fragTexCoord;\n"
+	"in vec4 fragColor;\n"
+	"out vec4 finalColor;\n"
+	"uniform sampler2D texture0;\n"
+	"void main()\n"
+	"{\n"
+	"	finalColor = texture(texture0, fragTexCoord.xy / fragTexCoord.z) * fragColor;\n"
+	"}\n";
+#else
+#if defined(GRAPHICS_API_OPENGL_ES2)
+#define WALL_SHADER_HEADER "#version 100\nprecision mediump float;\n"
+#else
+#define WALL_SHADER_HEADER "#version 120\n"
+#endif
+static const char *wallVertexShader =
+	WALL_SHADER_HEADER
+	"attribute vec3 vertexPosition;\n"
+	"attribute vec3 vertexTexCoord;\n"
+	"attribute vec4 vertexColor;\n"
+	"varying vec3 fragTexCoord;\n"
+	"varying vec4 fragColor;\n"
+	"uniform mat4 mvp;\n"
+	"void main()\n"
+	"{\n"
+	"	fragTexCoord = vertexTexCoord;\n"
+	"	fragColor = vertexColor;\n"
+	"	gl_Position = mvp * vec4(vertexPosition, 1.0);\n"
+	"}\n";
+static const char *wallFragmentShader =
+	WALL_SHADER_HEADER
+	"varying vec3 fragTexCoord;\n"
+	"varying vec4 fragColor;\n"
+	"uniform sampler2D texture0;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = texture2D(texture0, fragTexCoord.xy / fragTexCoord.z) * fragColor;\n"
+	"}\n";
+#endif
+
+/*
+ * Creates the buffers for up to capacity quads, capacity * 4 has to fit the 16 bit indices. Needs
+ * a GL context. The batch isn't ready if the GL version has no vertex arrays or shaders, draw the
+ * quads the usual way then.
+ */
+WallBatch LoadWallBatch(int capacity)
+{
+	WallBatch batch = { 0 };
+	batch.shader = LoadShaderFromMemory(wallVertexShader, wallFragmentShader);
+	if (batch.shader.id == rlGetShaderIdDefault())
+	{
+		// raylib hands back its default shader when compiling fails
+		batch.shader = (Shader){ 0 };
+		return batch;
+	}
+	batch.vao = rlLoadVertexArray();
+	if (batch.vao == 0)
+	{
+		UnloadShader(batch.shader);
+		batch.shader = (Shader){ 0 };
+		return batch;
+	}
+
+	batch.capacity = capacity;
+	batch.positions = calloc((size_t)capacity * 4, sizeof(Vector2));
+	batch.texcoords = calloc((size_t)capacity * 4, sizeof(Vector3));
+	batch.colors = calloc((size_t)capacity * 4, sizeof(Color));
+
+	// Every quad is split into two triangles the same way raylib splits its own quads
+	unsigned short *indices = malloc((size_t)capacity * 6 * sizeof(unsigned short));
+	for (int i = 0; i < capacity; i++)
+	{
+		indices[(i * 6) + 0] = (unsigned short)((i * 4) + 0);
+		indices[(i * 6) + 1] = (unsigned short)((i * 4) + 1);
+		indices[(i * 6) + 2] = (unsigned short)((i * 4) + 2);
+		indices[(i * 6) + 3] = (unsigned short)((i * 4) + 0);
+		indices[(i * 6) + 4] = (unsigned short)((i * 4) + 2);
+		indices[(i * 6) + 5] = (unsigned short)((i * 4) + 3);
+	}
+
+	// One buffer per attribute so every attribute starts at offset 0
+	rlEnableVertexArray(batch.vao);
+	batch.positionBuffer = rlLoadVertexBuffer(batch.positions, capacity * 4 * sizeof(Vector2), true);
+	rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION, 2, RL_FLOAT, false, 0, 0);
+	rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_POSITION);
+	batch.texcoordBuffer = rlLoadVertexBuffer(batch.texcoords, capacity * 4 * sizeof(Vector3), true);
+	rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD, 3, RL_FLOAT, false, 0, 0);
+	rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_TEXCOORD);
+	batch.colorBuffer = rlLoadVertexBuffer(batch.colors, capacity * 4 * sizeof(Color), true);
+	rlSetVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR, 4, RL_UNSIGNED_BYTE, true, 0, 0);
+	rlEnableVertexAttribute(RL_DEFAULT_SHADER_ATTRIB_LOCATION_COLOR);
+	batch.indexBuffer = rlLoadVertexBufferElement(indices, capacity * 6 * sizeof(unsigned short), false);
+	rlDisableVertexArray();
+
+	free(indices);
+	return batch;
+}
+
+void UnloadWallBatch(WallBatch batch)
+{
+	if (batch.vao != 0)
+	{
+		rlUnloadVertexBuffer(batch.positionBuffer);
+		rlUnloadVertexBuffer(batch.texcoordBuffer);
+		rlUnloadVertexBuffer(batch.colorBuffer);
+		rlUnloadVertexBuffer(batch.indexBuffer);
+		rlUnloadVertexArray(batch.vao);
+		UnloadShader(batch.shader);
+	}
+	free(batch.positions);
+	free(batch.texcoords);
+	free(batch.colors);
+}
+
+bool IsWallBatchReady(WallBatch batch)
+{
+	return batch.vao != 0 && batch.shader.id != 0 && batch.capacity > 0;
+}
+
+void ClearWallBatch(WallBatch *batch)
+{
+	batch->count = 0;
+}
+
+/*
+ * Adds the quad between two edges of a wall, texture rows v0 to v1 (normalized) run from top to
+ * bottom. The edges' q make the texture perspective correct in between, so one segment can stand
+ * in for any number of columns of the same wall face. Quads past the capacity are dropped.
+ */
+void AddWallSegment(WallBatch *batch, WallEdge left, WallEdge right, float v0, float v1)
+{
+	if (batch->count >= batch->capacity) { return; }
+
+	const int first = batch->count * 4;
+	batch->positions[first + 0] = (Vector2){ left.x, left.top };
+	batch->positions[first + 1] = (Vector2){ left.x, left.bottom };
+	batch->positions[first + 2] = (Vector2){ right.x, right.bottom };
+	batch->positions[first + 3] = (Vector2){ right.x, right.top };
+	batch->texcoords[first + 0] = (Vector3){ left.u * left.q, v0 * left.q, left.q };
+	batch->texcoords[first + 1] = (Vector3){ left.u * left.q, v1 * left.q, left.q };
+	batch->texcoords[first + 2] = (Vector3){ right.u * right.q, v1 * right.q, right.q };
+	batch->texcoords[first + 3] = (Vector3){ right.u * right.q, v0 * right.q, right.q };
+	batch->colors[first + 0] = left.tint;
+	batch->colors[first + 1] = left.tint;
+	batch->colors[first + 2] = right.tint;
+	batch->colors[first + 3] = right.tint;
+	batch->count++;
+}
+
+/*
+ * Copies the quads into the GPU buffers in place and draws them all at once, on top of whatever
+ * was drawn so far.
+ */
+void DrawWallBatch(WallBatch *batch, unsigned int textureId)
+{
+	if (!IsWallBatchReady(*batch) || batch->count == 0) { return; }
+
+	// Anything still waiting in raylib's own batch belongs underneath the walls
+	rlDrawRenderBatchActive();
+
+	const int vertexCount = batch->count * 4;
+	rlUpdateVertexBuffer(batch->positionBuffer, batch->positions, vertexCount * sizeof(Vector2), 0);
+	rlUpdateVertexBuffer(batch->texcoordBuffer, batch->texcoords, vertexCount * sizeof(Vector3), 0);
+	rlUpdateVertexBuffer(batch->colorBuffer, batch->colors, vertexCount * sizeof(Color), 0);
+
+	const int textureSlot = 0;
+	rlEnableShader(batch->shader.id);
+	rlSetUniformMatrix(batch->shader.locs[SHADER_LOC_MATRIX_MVP], MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection()));
+	rlSetUniform(batch->shader.locs[SHADER_LOC_MAP_DIFFUSE], &textureSlot, RL_SHADER_UNIFORM_INT, 1);
+	rlActiveTextureSlot(0);
+	rlEnableTexture(textureId);
+
+	rlEnableVertexArray(batch->vao);
+	rlDrawVertexArrayElements(0, batch->count * 6, 0);
+	rlDisableVertexArray();
+
+	rlDisableTexture();
+	rlDisableShader();
+}
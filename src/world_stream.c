@@ -0,0 +1,254 @@
+#include "world_stream.h"
+#include "level.h"
+#include "job_system.h"
+#include "helpful_math.h"
+
+#include <stdlib.h>
+
+#define STREAM_SLOTS 16				// Chunk loads in flight at once
+#define STREAM_CHUNKS_PER_UPDATE 1	// Chunks stored or evicted per update, each one queues a rebuild of the renderer's map window
+#define STREAM_LOOKAHEAD 0.5f		// How far ahead of the camera loads are centred, in window radii
+
+typedef enum ChunkState {
+	CHUNK_EVICTED,
+	CHUNK_LOADING,
+	CHUNK_RESIDENT
+} ChunkState;
+
+// Page of one chunk being read in on the background thread
+typedef struct StreamSlot {
+	int chunk;			// -1 when the slot is free
+	MapPage *page;		// Allocated when the load is queued, handed to the map when it is stored
+	JobCounter done;
+} StreamSlot;
+
+// Chunk waiting to be loaded, sorted by distance
+typedef struct StreamRequest {
+	int chunk;
+	float distance;
+} StreamRequest;
+
+static LevelFile level;
+static Map map;
+static uint8_t *chunkStates;		// ChunkState of every chunk in the level
+static int *residentChunks;
+static int residentCount;
+static int residentBudget;
+static int chunkRadius;
+static StreamSlot slots[STREAM_SLOTS];
+static StreamRequest *requests;		// Room for every chunk in the window
+
+/*
+ * Opens a level for streaming. Only the chunks within chunkRadius chunks of the camera are kept
+ * in the map, everything else reads as wall until it is loaded so rays and collision stop at
+ * unloaded space instead of seeing through it. Each chunk is one page of the map, allocated when
+ * it is loaded and freed when it is evicted, so memoryBudget caps the memory of the map's pages.
+ * It is raised to at least fit the window around the camera. Fails for levels whose chunks aren't
+ * MAP_PAGE_SIZE cells a side.
+ */
+bool CreateWorldStream(const char *fileName, int chunkRadius_, size_t memoryBudget)
+{
+	level = OpenLevelFile(fileName);
+	if (!IsLevelFileReady(level)) { return false; }
+
+	map = LoadMapSolid(level.width, level.height);
+	if (level.chunkSize != MAP_PAGE_SIZE || !IsMapReady(map))
+	{
+		UnloadMap(map);
+		map = (Map){ 0 };
+		CloseLevelFile(level);
+		return false;
+	}
+
+	chunkRadius = MAX(chunkRadius_, 0);
+	const int windowChunks = ((2 * chunkRadius) + 1) * ((2 * chunkRadius) + 1);
+	residentBudget = MAX((int)(memoryBudget / sizeof(MapPage)), windowChunks);
+	residentCount = 0;
+
+	chunkStates = calloc((size_t)level.chunkCols * level.chunkRows, sizeof(uint8_t));
+	residentChunks = malloc((residentBudget + STREAM_SLOTS) * sizeof(int));
+	requests = malloc(windowChunks * sizeof(StreamRequest));
+	for (int i = 0; i < STREAM_SLOTS; i++)
+	{
+		slots[i] = (StreamSlot){ -1, NULL, { 0 } };
+	}
+	return true;
+}
+
+/*
+ * Waits for any loads still in flight, then unloads the map and closes the level.
+ */
+void DestroyWorldStream()
+{
+	for (int i = 0; i < STREAM_SLOTS; i++)
+	{
+		WaitJobCounter(&slots[i].done);
+		UnloadMapPage(slots[i].page);
+		slots[i] = (StreamSlot){ -1, NULL, { 0 } };
+	}
+	free(chunkStates);
+	free(residentChunks);
+	free(requests);
+	chunkStates = NULL;
+	residentChunks = NULL;
+	requests = NULL;
+	residentCount = 0;
+
+	UnloadMap(map);
+	map = (Map){ 0 };
+	CloseLevelFile(level);
+	level = (LevelFile){ 0 };
+}
+
+// The streamed map, hand it to the renderer and player like any other map
+Map *GetWorldStreamMap() { return &map; }
+
+int GetResidentChunkCount() { return residentCount; }
+
+bool IsWorldCellResident(int col, int row)
+{
+	if (!IsMapCellInside(&map, col, row)) { return false; }
+	return chunkStates[((row / level.chunkSize) * level.chunkCols) + (col / level.chunkSize)] == CHUNK_RESIDENT;
+}
+
+// Background job, only reads the level mapping and writes its own slot
+static void LoadChunkJob(void *data, int first, int count)
+{
+	StreamSlot *slot = data;
+	ReadLevelChunkCells(&level, slot->chunk % level.chunkCols, slot->chunk / level.chunkCols, slot->page->cells);
+}
+
+/*
+ * Hands a loaded chunk's page to the map, which marks its cells dirty.
+ */
+static void StoreChunk(int chunk, MapPage *page)
+{
+	StoreMapPage(&map, chunk % level.chunkCols, chunk / level.chunkCols, page);
+	chunkStates[chunk] = CHUNK_RESIDENT;
+	residentChunks[residentCount++] = chunk;
+}
+
+/*
+ * Frees the chunk's page so it reads as wall again and lets the OS drop its file pages.
+ */
+static void EvictChunk(int residentIndex)
+{
+	const int chunk = residentChunks[residentIndex];
+	StoreMapPage(&map, chunk % level.chunkCols, chunk / level.chunkCols, NULL);
+	ReleaseLevelChunk(&level, chunk % level.chunkCols, chunk / level.chunkCols);
+
+	chunkStates[chunk] = CHUNK_EVICTED;
+	residentChunks[residentIndex] = residentChunks[--residentCount];
+}
+
+// Chunks away from the camera's chunk, counting diagonals as one like the window does
+static int GetChunkDistance(int chunk, int chunkCol, int chunkRow)
+{
+	return MAX(abs((chunk % level.chunkCols) - chunkCol), abs((chunk / level.chunkCols) - chunkRow));
+}
+
+static int CompareRequests(const void *a, const void *b)
+{
+	const float x = ((const StreamRequest *)a)->distance;
+	const float y = ((const StreamRequest *)b)->distance;
+	return (x > y) - (x < y);
+}
+
+/*
+ * Loads every chunk in the window around position right away, e.g. before the first frame so the
+ * player doesn't start out walled in.
+ */
+void FillWorldStream(Vector2 position)
+{
+	const int cameraCol = (int)position.x / level.chunkSize;
+	const int cameraRow = (int)position.y / level.chunkSize;
+	for (int chunkRow = MAX(cameraRow - chunkRadius, 0); chunkRow <= MIN(cameraRow + chunkRadius, level.chunkRows - 1); chunkRow++)
+	{
+		for (int chunkCol = MAX(cameraCol - chunkRadius, 0); chunkCol <= MIN(cameraCol + chunkRadius, level.chunkCols - 1); chunkCol++)
+		{
+			const int chunk = (chunkRow * level.chunkCols) + chunkCol;
+			if (chunkStates[chunk] != CHUNK_EVICTED || residentCount >= residentBudget) { continue; }
+
+			MapPage *page = LoadMapPage();
+			if (page == NULL) { continue; }
+			ReadLevelChunkCells(&level, chunkCol, chunkRow, page->cells);
+			StoreChunk(chunk, page);
+		}
+	}
+
+	CommitMapChanges(&map);
+}
+
+/*
+ * Call once per frame. Never waits on a load: a finished load is copied into the map or, while
+ * over budget, the chunk furthest from the camera is evicted instead, and missing chunks of the
+ * window are queued on the background thread, those ahead of the camera first. The changes are
+ * committed to the map's listeners at the end.
+ */
+void UpdateWorldStream(Vector2 position, Vector2 forward)
+{
+	const int cameraCol = (int)position.x / level.chunkSize;
+	const int cameraRow = (int)position.y / level.chunkSize;
+
+	// Evicting comes first when over budget so the count never grows past it, a stored chunk waits for the next update
+	int changed = 0;
+	if (residentCount > residentBudget)
+	{
+		int furthest = 0;
+		for (int i = 1; i < residentCount; i++)
+		{
+			if (GetChunkDistance(residentChunks[i], cameraCol, cameraRow) > GetChunkDistance(residentChunks[furthest], cameraCol, cameraRow)) { furthest = i; }
+		}
+		if (GetChunkDistance(residentChunks[furthest], cameraCol, cameraRow) > chunkRadius)
+		{
+			EvictChunk(furthest);
+			changed++;
+		}
+	}
+
+	for (int i = 0; i < STREAM_SLOTS && changed < STREAM_CHUNKS_PER_UPDATE; i++)
+	{
+		StreamSlot *slot = &slots[i];
+		if (slot->chunk < 0 || !IsJobCounterDone(&slot->done)) { continue; }
+
+		StoreChunk(slot->chunk, slot->page);
+		slot->chunk = -1;
+		slot->page = NULL;
+		changed++;
+	}
+
+	// Queue missing chunks of the window, nearest to a point ahead of the camera first
+	const float lookahead = STREAM_LOOKAHEAD * chunkRadius * level.chunkSize;
+	const Vector2 focus = Vector2Add(position, Vector2Scale(forward, lookahead));
+	int requestCount = 0;
+	for (int chunkRow = MAX(cameraRow - chunkRadius, 0); chunkRow <= MIN(cameraRow + chunkRadius, level.chunkRows - 1); chunkRow++)
+	{
+		for (int chunkCol = MAX(cameraCol - chunkRadius, 0); chunkCol <= MIN(cameraCol + chunkRadius, level.chunkCols - 1); chunkCol++)
+		{
+			const int chunk = (chunkRow * level.chunkCols) + chunkCol;
+			if (chunkStates[chunk] != CHUNK_EVICTED) { continue; }
+
+			const Vector2 center = {
+				((float)chunkCol + 0.5f) * level.chunkSize,
+				((float)chunkRow + 0.5f) * level.chunkSize
+			};
+			requests[requestCount++] = (StreamRequest){ chunk, Vector2DistanceSqr(center, focus) };
+		}
+	}
+	qsort(requests, requestCount, sizeof(StreamRequest), CompareRequests);
+
+	int next = 0;
+	for (int i = 0; i < STREAM_SLOTS && next < requestCount; i++)
+	{
+		StreamSlot *slot = &slots[i];
+		if (slot->chunk >= 0) { continue; }
+
+		slot->page = LoadMapPage();
+		if (slot->page == NULL) { break; }
+		slot->chunk = requests[next++].chunk;
+		chunkStates[slot->chunk] = CHUNK_LOADING;
+		RunBackgroundJob(LoadChunkJob, slot, 0, 1, &slot->done);
+	}
+
+	CommitMapChanges(&map);
+}
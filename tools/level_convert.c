@@ -0,0 +1,134 @@
+/*
+ * mengine-level
+ * Converts levels into the binary chunked format read by OpenLevelFile().
+ *
+ * Usage: mengine-level <input.png | input.txt> <output.lvl>
+ *
+ * PNG input is read as grayscale, one pixel per cell, dark pixels (below half brightness) become
+ * walls. Text input is the same layout as the C arrays levels used to be compiled from, one row of
+ * cells per line with the values separated by anything that isn't a digit, e.g. "{ 1,0,0,1 },".
+ * Lines without any digits are skipped.
+ */
+
+#include "raylib.h"
+#include "map.h"
+#include "level.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE_LENGTH 65536
+
+static Map LoadMapFromGrayscaleImage(const char *fileName)
+{
+	Image image = LoadImage(fileName);
+	if (!IsImageReady(image)) { return (Map){ 0 }; }
+
+	Map map = LoadMapEmpty(image.width, image.height);
+	Color *colors = LoadImageColors(image);
+	if (IsMapReady(map) && colors != NULL)
+	{
+		for (int i = 0; i < image.width * image.height; i++)
+		{
+			const int brightness = (colors[i].r + colors[i].g + colors[i].b) / 3;
+			SetMapCell(&map, i % image.width, i / image.width, brightness < 128 ? CELL_WALL : CELL_EMPTY);
+		}
+	}
+	UnloadImageColors(colors);
+	UnloadImage(image);
+	return map;
+}
+
+// Reads the values of one line into values, returns how many there were
+static int ParseArrayLine(const char *line, unsigned int *values, int maxValues)
+{
+	int count = 0;
+	for (const char *c = line; *c != '\0';)
+	{
+		if (!isdigit((unsigned char)*c))
+		{
+			c++;
+			continue;
+		}
+
+		char *end;
+		const unsigned long value = strtoul(c, &end, 10);
+		if (count < maxValues) { values[count] = (unsigned int)value; }
+		count++;
+		c = end;
+	}
+	return count;
+}
+
+static Map LoadMapFromArrayText(const char *fileName)
+{
+	FILE *file = fopen(fileName, "r");
+	if (file == NULL) { return (Map){ 0 }; }
+
+	char *line = malloc(MAX_LINE_LENGTH);
+	unsigned int *data = NULL;
+	int width = 0;
+	int height = 0;
+	bool valid = line != NULL;
+	while (valid && fgets(line, MAX_LINE_LENGTH, file) != NULL)
+	{
+		const int count = ParseArrayLine(line, NULL, 0);
+		if (count == 0) { continue; }
+		if (width == 0) { width = count; }
+		if (count != width)
+		{
+			fprintf(stderr, "%s: row %d has %d cells, expected %d\n", fileName, height + 1, count, width);
+			valid = false;
+			break;
+		}
+
+		unsigned int *grown = realloc(data, (size_t)width * (height + 1) * sizeof(unsigned int));
+		if (grown == NULL)
+		{
+			valid = false;
+			break;
+		}
+		data = grown;
+		ParseArrayLine(line, &data[(size_t)width * height], width);
+		height++;
+	}
+	fclose(file);
+
+	Map map = valid && height > 0 ? LoadMapFromArray(data, width, height) : (Map){ 0 };
+	free(data);
+	free(line);
+	return map;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3)
+	{
+		fprintf(stderr, "Usage: %s <input.png | input.txt> <output.lvl>\n", argv[0]);
+		return 1;
+	}
+
+	SetTraceLogLevel(LOG_WARNING);
+
+	const char *inName = argv[1];
+	const char *outName = argv[2];
+	Map map = IsFileExtension(inName, ".png") ? LoadMapFromGrayscaleImage(inName) : LoadMapFromArrayText(inName);
+	if (!IsMapReady(map))
+	{
+		fprintf(stderr, "Could not load %s\n", inName);
+		return 1;
+	}
+
+	if (!ExportLevelFile(&map, outName))
+	{
+		fprintf(stderr, "Could not write %s\n", outName);
+		UnloadMap(map);
+		return 1;
+	}
+
+	printf("%s: %d x %d cells\n", outName, map.width, map.height);
+	UnloadMap(map);
+	return 0;
+}